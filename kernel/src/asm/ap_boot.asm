@@ -5,6 +5,8 @@ global g_ap_trampoline_end
 global g_ap_ready_count
 global g_ap_lock
 global g_ap_target_cpu
+global g_ap_cr3
+global g_ap_stack
 
 g_ap_trampoline_start:
     cli
@@ -34,10 +36,10 @@ ap_protected_mode:
     mov esp, 0x9000
 
     mov eax, cr4
-    or eax, (1 << 5)
+    or eax, (1 << 5) | (1 << 7)
     mov cr4, eax
 
-    mov eax, [ap_cr3 - g_ap_trampoline_start + 0x8000]
+    mov eax, [g_ap_cr3 - g_ap_trampoline_start + 0x8000]
     mov cr3, eax
 
     mov ecx, 0xC0000080
@@ -60,9 +62,11 @@ ap_long_mode:
     mov gs, ax
     mov ss, ax
 
+    mov rsp, [g_ap_stack]
     mov edi, [g_ap_target_cpu]
 
-    call ap_main
+    mov rax, ap_main
+    call rax
 
 ap_halt:
     cli
@@ -104,7 +108,7 @@ ap_gdtr:
     dw (5 * 8) - 1
     dq ap_gdt
 
-ap_cr3:
+g_ap_cr3:
     dq 0
 
 g_ap_ready_count:
@@ -113,6 +117,8 @@ g_ap_lock:
     dd 0
 g_ap_target_cpu:
     dd 0
+g_ap_stack:
+    dq 0
 
 align 16
 g_ap_trampoline_end:
@@ -96,4 +96,8 @@ ISR_NOERRCODE 31
 %rep 16
 ISR_NOERRCODE i
 %assign i i+1
-%endrep
\ No newline at end of file
+%endrep
+
+ISR_NOERRCODE 64
+ISR_NOERRCODE 65
+ISR_NOERRCODE 128
\ No newline at end of file
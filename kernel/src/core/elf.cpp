@@ -60,7 +60,10 @@ bool ElfLoader::map_segment(const Elf64_Phdr* phdr, const char* base) {
         uintptr_t phys_page = reinterpret_cast<uintptr_t>(pmm.allocate_frame());
         if (phys_page == 0) return false;
 
-        vmm.map_page(addr, phys_page, (phdr->p_flags & PF_W) != 0);
+        if (!vmm.map_page(addr, phys_page, (phdr->p_flags & PF_W) != 0)) {
+            pmm.free_frame(reinterpret_cast<void*>(phys_page));
+            return false;
+        }
     }
 
     memcpy(reinterpret_cast<void*>(phdr->p_vaddr), base + phdr->p_offset, phdr->p_filesz);
@@ -6,12 +6,48 @@
 #include "lib/string.hpp"
 #include "lib/vector.hpp"
 #include "memory/physical_memory.hpp"
+#include "memory/slab.hpp"
 #include "memory/virtual_memory.hpp"
 #include "process.hpp"
 #include "scheduler.hpp"
 
 namespace kernel {
 
+namespace {
+SlabCache* message_queue_cache() {
+    static SlabCache* cache = SlabAllocator::instance().create_cache(
+        "message_queue", sizeof(MessageQueue), alignof(MessageQueue));
+    return cache;
+}
+
+SlabCache* shared_memory_cache() {
+    static SlabCache* cache = SlabAllocator::instance().create_cache(
+        "shared_memory", sizeof(SharedMemoryRegion), alignof(SharedMemoryRegion));
+    return cache;
+}
+
+void release_shared_pages(void* address, size_t size) {
+    uint64_t start = reinterpret_cast<uint64_t>(address);
+    VirtualMemoryManager::instance().unmap_range(start, (size + 4095) & ~4095, true);
+}
+}  // namespace
+
+void* MessageQueue::operator new(size_t) {
+    return message_queue_cache()->allocate();
+}
+
+void MessageQueue::operator delete(void* ptr) {
+    message_queue_cache()->free(ptr);
+}
+
+void* SharedMemoryRegion::operator new(size_t) {
+    return shared_memory_cache()->allocate();
+}
+
+void SharedMemoryRegion::operator delete(void* ptr) {
+    shared_memory_cache()->free(ptr);
+}
+
 MessageQueue::MessageQueue(pid_t owner, const char* name) : m_owner(owner) {
     size_t len = strlen(name) + 1;
     m_name = new char[len];
@@ -26,6 +62,8 @@ MessageQueue::~MessageQueue() {
         if (process->state == ProcessState::Waiting && process->waiting_on == this) {
             process->state = ProcessState::Ready;
             process->waiting_on = nullptr;
+
+            Scheduler::instance().add_process(process);
         }
     }
 
@@ -74,9 +112,9 @@ bool MessageQueue::receive_message(IPCMessage& message, bool wait) {
 
         if (!current) return false;
 
-        current->state = ProcessState::Waiting;
         current->waiting_on = this;
         m_waiting_processes.push_back(current);
+        Scheduler::instance().block_process(current);
 
         Scheduler::instance().schedule();
 
@@ -110,21 +148,7 @@ IPCManager::~IPCManager() {
 
     for (size_t i = 0; i < m_shared_memory_regions.size(); i++) {
         auto* region = m_shared_memory_regions[i];
-        if (region->address) {
-            auto& pmm = PhysicalMemoryManager::instance();
-            size_t num_pages = (region->size + 4095) / 4096;
-
-            for (size_t i = 0; i < num_pages; i++) {
-                uint64_t addr = reinterpret_cast<uint64_t>(region->address) + i * 4096;
-                auto& vmm = VirtualMemoryManager::instance();
-                uintptr_t phys_addr = vmm.get_physical_address(addr);
-
-                if (phys_addr) {
-                    pmm.free_frame(reinterpret_cast<void*>(phys_addr));
-                    vmm.unmap_page(addr);
-                }
-            }
-        }
+        if (region->address) release_shared_pages(region->address, region->size);
 
         delete region;
     }
@@ -217,29 +241,37 @@ int32_t IPCManager::create_shared_memory(pid_t creator, size_t size) {
     region->address = reinterpret_cast<void*>(shared_mem_base);
 
     size_t num_pages = size / 4096;
+    if (size >= VirtualMemoryManager::LARGE_PAGE_SIZE) {
+        void* frames = pmm.allocate_contiguous(num_pages, VirtualMemoryManager::LARGE_PAGE_SIZE);
+        if (frames) {
+            memset(phys_to_virt(reinterpret_cast<uintptr_t>(frames)), 0, size);
+            if (vmm.map_range(shared_mem_base, reinterpret_cast<uintptr_t>(frames), size)) {
+                region->attached_processes.push_back(creator);
+                m_shared_memory_regions.push_back(region);
+                return region->id;
+            }
+
+            if (!vmm.unmap_range(shared_mem_base, size)) {
+                delete region;
+                return -1;
+            }
+            pmm.free_contiguous(frames, num_pages);
+        }
+    }
+
     for (size_t i = 0; i < num_pages; i++) {
         uint64_t addr = shared_mem_base + i * 4096;
-        uintptr_t phys_page = reinterpret_cast<uintptr_t>(pmm.allocate_frame());
-
-        if (!phys_page) {
-            for (size_t j = 0; j < i; j++) {
-                uint64_t cleanup_addr = shared_mem_base + j * 4096;
-                uintptr_t phys_addr = vmm.get_physical_address(cleanup_addr);
-                if (phys_addr) {
-                    pmm.free_frame(reinterpret_cast<void*>(phys_addr));
-                    vmm.unmap_page(cleanup_addr);
-                }
-            }
+        uintptr_t phys_page = reinterpret_cast<uintptr_t>(pmm.allocate_zeroed_frame());
+
+        if (!phys_page || !vmm.map_page(addr, phys_page, true)) {
+            if (phys_page) pmm.free_frame(reinterpret_cast<void*>(phys_page));
+            release_shared_pages(region->address, i * 4096);
 
             delete region;
             return -1;
         }
-
-        vmm.map_page(addr, phys_page, true);
     }
 
-    memset(region->address, 0, size);
-
     region->attached_processes.push_back(creator);
 
     m_shared_memory_regions.push_back(region);
@@ -254,22 +286,7 @@ bool IPCManager::destroy_shared_memory(int32_t id) {
         if (!region) continue;
 
         if (region->id == id) {
-            if (region->address) {
-                auto& pmm = PhysicalMemoryManager::instance();
-                auto& vmm = VirtualMemoryManager::instance();
-
-                size_t num_pages = (region->size + 4095) / 4096;
-
-                for (size_t j = 0; j < num_pages; j++) {
-                    uint64_t addr = reinterpret_cast<uint64_t>(region->address) + j * 4096;
-                    uintptr_t phys_addr = vmm.get_physical_address(addr);
-
-                    if (phys_addr) {
-                        pmm.free_frame(reinterpret_cast<void*>(phys_addr));
-                        vmm.unmap_page(addr);
-                    }
-                }
-            }
+            if (region->address) release_shared_pages(region->address, region->size);
 
             delete region;
 
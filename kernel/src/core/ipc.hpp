@@ -24,6 +24,9 @@ public:
     MessageQueue(pid_t owner, const char* name);
     ~MessageQueue();
 
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
+
     bool send_message(pid_t sender, const void* data, size_t size);
 
     bool receive_message(IPCMessage& message, bool wait);
@@ -54,6 +57,9 @@ struct SharedMemoryRegion {
     size_t size = 0;
     void* address = nullptr;
     Vector<pid_t> attached_processes;
+
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
 };
 
 class IPCManager {
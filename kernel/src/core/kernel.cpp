@@ -18,6 +18,7 @@
 #include "process.hpp"
 #include "rtc.hpp"
 #include "scheduler.hpp"
+#include "serial.hpp"
 #include "shell.hpp"
 #include "terminal.hpp"
 #include "timer.hpp"
@@ -25,7 +26,7 @@
 #include "virtual_memory.hpp"
 
 extern "C" void kernel_main() {
-    volatile uint16_t* vga = reinterpret_cast<uint16_t*>(0xB8000);
+    volatile uint16_t* vga = vga_memory();
 
     const char* msg1 = "[1] Kernel Start";
     for (int i = 0; msg1[i] != '\0'; i++) {
@@ -33,6 +34,7 @@ extern "C" void kernel_main() {
     }
 
     init_gdt();
+    init_serial();
 
     const char* msg2 = "[2] GDT Init Done";
     for (int i = 0; msg2[i] != '\0'; i++) {
@@ -55,14 +57,11 @@ extern "C" void kernel_main() {
 
     constexpr size_t MEMORY_START = 0x100000;
     constexpr size_t MEMORY_SIZE = 64 * 1024 * 1024;
-    constexpr size_t HEAP_SIZE = 16 * 1024 * 1024;
 
     auto& pmm = PhysicalMemoryManager::instance();
 
     const auto* mb_memory_map = kernel::get_memory_map();
-    if (mb_memory_map)
-        pmm.initialize(MEMORY_START, MEMORY_SIZE);
-    else
+    if (!mb_memory_map || !pmm.initialize(mb_memory_map))
         pmm.initialize(MEMORY_START, MEMORY_SIZE);
 
     const char* msg5 = "[5] PMM Init Done";
@@ -78,16 +77,6 @@ extern "C" void kernel_main() {
         vga[i + 400] = 0x0F00 | msg6[i];
     }
 
-    uintptr_t heap_start = MEMORY_START + MEMORY_SIZE - HEAP_SIZE;
-    for (uintptr_t addr = heap_start; addr < heap_start + HEAP_SIZE; addr += 4096) {
-        vmm.map_page(addr, addr, true);
-    }
-
-    const char* msg7 = "[7] Heap Mapped";
-    for (int i = 0; msg7[i] != '\0'; i++) {
-        vga[i + 480] = 0x0F00 | msg7[i];
-    }
-
     vmm.load_page_directory();
 
     const char* msg8 = "[8] Page Tables Loaded";
@@ -124,7 +113,7 @@ extern "C" void kernel_main() {
     }
 
     auto& heap = HeapAllocator::instance();
-    heap.initialize(heap_start, HEAP_SIZE);
+    heap.initialize(HeapAllocator::VIRTUAL_BASE, HeapAllocator::MAX_SIZE);
 
     auto& fs = fs::CFat32FileSystem::instance();
     if (!fs.mount()) {
@@ -137,14 +126,6 @@ extern "C" void kernel_main() {
         vga[i + 960] = 0x0F00 | msg13[i];
     }
 
-    auto& scheduler = kernel::Scheduler::instance();
-    scheduler.initialize(kernel::SchedulerPolicy::RoundRobin);
-
-    const char* msg15 = "[14] Scheduler Init Done";
-    for (int i = 0; msg15[i] != '\0'; i++) {
-        vga[i + 1120] = 0x0F00 | msg15[i];
-    }
-
     auto& smp = kernel::SMPManager::instance();
     smp.initialize();
 
@@ -153,6 +134,14 @@ extern "C" void kernel_main() {
         vga[i + 1200] = 0x0F00 | msg16[i];
     }
 
+    auto& scheduler = kernel::Scheduler::instance();
+    scheduler.initialize(kernel::SchedulerPolicy::Fair);
+
+    const char* msg15 = "[14] Scheduler Init Done";
+    for (int i = 0; msg15[i] != '\0'; i++) {
+        vga[i + 1120] = 0x0F00 | msg15[i];
+    }
+
     if (smp.is_smp_enabled()) {
         smp.startup_application_processors();
 
@@ -170,6 +159,6 @@ extern "C" void kernel_main() {
 
     asm volatile("sti");
     for (;;) {
-        asm volatile("hlt");
+        if (!pmm.refill_zero_pool()) asm volatile("hlt");
     }
 }
\ No newline at end of file
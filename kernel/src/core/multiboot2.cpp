@@ -1,12 +1,13 @@
 #include "multiboot2.hpp"
 
 #include "terminal.hpp"
+#include "vga.hpp"
 
 static uintptr_t multiboot_info_addr = 0;
 static const kernel::MultibootMemoryMapTag* memory_map = nullptr;
 
 static void early_print(const char* msg, uint64_t value = 0) {
-    volatile uint16_t* vga = reinterpret_cast<uint16_t*>(0xB8000);
+    volatile uint16_t* vga = vga_memory();
     static int y = 0;
 
     for (int i = 0; msg[i] != '\0' && i < 80; i++) {
@@ -142,4 +143,13 @@ const MultibootMemoryMapTag* get_memory_map() {
     return memory_map;
 }
 
+uintptr_t get_multiboot_info_address() {
+    return multiboot_info_addr;
+}
+
+uint32_t get_multiboot_info_size() {
+    if (!multiboot_info_addr) return 0;
+    return *reinterpret_cast<uint32_t*>(multiboot_info_addr);
+}
+
 }  // namespace kernel
\ No newline at end of file
@@ -75,5 +75,7 @@ struct MultibootMemoryMapTag {
 };
 
 const MultibootMemoryMapTag* get_memory_map();
+uintptr_t get_multiboot_info_address();
+uint32_t get_multiboot_info_size();
 
 }  // namespace kernel
\ No newline at end of file
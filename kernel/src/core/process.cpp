@@ -5,38 +5,40 @@
 #include "fs/fat32.hpp"
 #include "memory/heap.hpp"
 #include "memory/physical_memory.hpp"
+#include "memory/slab.hpp"
+#include "memory/tlb.hpp"
 #include "memory/virtual_memory.hpp"
 #include "scheduler.hpp"
 
 namespace kernel {
 
 namespace {
-char* strdup(const char* str) {
-    size_t len = strlen(str) + 1;
-    char* new_str = new char[len];
-    memcpy(new_str, str, len);
-    return new_str;
-}
-
-void add_memory_region(Process* process, uint64_t start, uint64_t size, bool writable,
-                       bool executable) {
-    auto* region = new MemoryRegion;
-    region->start = start;
-    region->size = size;
-    region->writable = writable;
-    region->executable = executable;
-    region->next = process->memory_regions;
-    process->memory_regions = region;
+SlabCache* process_cache() {
+    static SlabCache* cache =
+        SlabAllocator::instance().create_cache("process", sizeof(Process), alignof(Process));
+    return cache;
 }
 
 extern "C" void switch_context(RegisterState* old_state, RegisterState* new_state);
 }  // namespace
 
+void* Process::operator new(size_t) {
+    return process_cache()->allocate();
+}
+
+void Process::operator delete(void* ptr) {
+    process_cache()->free(ptr);
+}
+
 ProcessManager& ProcessManager::instance() {
     static ProcessManager instance;
     return instance;
 }
 
+Process*& ProcessManager::current_slot() {
+    return m_current_processes[SMPManager::instance().get_current_cpu_id()];
+}
+
 pid_t ProcessManager::create_process(const char* name, pid_t ppid) {
     auto* process = new Process;
     process->pid = m_next_pid++;
@@ -54,19 +56,19 @@ pid_t ProcessManager::create_process(const char* name, pid_t ppid) {
     for (uint64_t i = 0; i < kernel_stack_pages; i++) {
         uint64_t addr = kernel_stack_base + i * 4096;
         uintptr_t phys_page = reinterpret_cast<uintptr_t>(pmm.allocate_frame());
-        if (!phys_page) {
+        if (!phys_page || !vmm.map_page(addr, phys_page, true)) {
+            if (phys_page) pmm.free_frame(reinterpret_cast<void*>(phys_page));
             cleanup_process_memory(process);
             delete[] process->name;
             delete process;
             return -1;
         }
-        vmm.map_page(addr, phys_page, true);
     }
 
     process->kernel_stack = kernel_stack_base + KERNEL_STACK_SIZE;
 
     m_first_process = process;
-    if (!m_current_process) m_current_process = process;
+    if (!current_slot()) current_slot() = process;
 
     Scheduler::instance().add_process(process);
 
@@ -104,9 +106,14 @@ void ProcessManager::terminate_process(pid_t pid) {
 
             delete[] current->name;
 
-            if (m_current_process == current) {
-                m_current_process = m_first_process;
-                if (m_current_process) Scheduler::instance().schedule();
+            Process*& running = current_slot();
+            if (running == current) {
+                running = m_first_process;
+                if (running) Scheduler::instance().schedule();
+            }
+
+            for (Process*& slot : m_current_processes) {
+                if (slot == current) slot = nullptr;
             }
 
             delete current;
@@ -149,6 +156,12 @@ bool ProcessManager::load_program(Process* process, const char* path) {
     auto& vmm = VirtualMemoryManager::instance();
     auto& pmm = PhysicalMemoryManager::instance();
 
+    if (!process->address_space) process->address_space = vmm.create_address_space();
+    if (!process->address_space) {
+        delete[] file_data;
+        return false;
+    }
+
     uint64_t highest_addr = 0;
 
     for (uint16_t i = 0; i < elf_header->e_phnum; i++) {
@@ -156,28 +169,42 @@ bool ProcessManager::load_program(Process* process, const char* path) {
 
         uint64_t vaddr_start = phdr[i].p_vaddr & ~0xFFF;
         uint64_t vaddr_end = (phdr[i].p_vaddr + phdr[i].p_memsz + 0xFFF) & ~0xFFF;
-        uint64_t size = vaddr_end - vaddr_start;
+
+        uint64_t file_start = phdr[i].p_vaddr;
+        uint64_t file_end = phdr[i].p_vaddr + phdr[i].p_filesz;
 
         for (uint64_t addr = vaddr_start; addr < vaddr_end; addr += 4096) {
-            uintptr_t phys_page = reinterpret_cast<uintptr_t>(pmm.allocate_frame());
-            if (phys_page == 0) {
-                cleanup_process_memory(process);
-                delete[] file_data;
-                return false;
-            }
-            vmm.map_page(addr, phys_page, (phdr[i].p_flags & PF_W) != 0);
-        }
+            uintptr_t phys_page =
+                addr < highest_addr ? vmm.get_physical_address(process->address_space, addr) : 0;
+            if (!phys_page) {
+                phys_page = reinterpret_cast<uintptr_t>(pmm.allocate_zeroed_frame());
+                if (phys_page == 0 || !vmm.map_page(process->address_space, addr, phys_page,
+                                                    (phdr[i].p_flags & PF_W) != 0,
+                                                    (phdr[i].p_flags & PF_X) != 0)) {
+                    if (phys_page) pmm.free_frame(reinterpret_cast<void*>(phys_page));
+                    cleanup_process_memory(process);
+                    delete[] file_data;
+                    return false;
+                }
 
-        memcpy(reinterpret_cast<void*>(phdr[i].p_vaddr), file_data + phdr[i].p_offset,
-               phdr[i].p_filesz);
+                process->resident_pages++;
+            }
 
-        if (phdr[i].p_memsz > phdr[i].p_filesz) {
-            memset(reinterpret_cast<void*>(phdr[i].p_vaddr + phdr[i].p_filesz), 0,
-                   phdr[i].p_memsz - phdr[i].p_filesz);
+            uint64_t copy_start = addr > file_start ? addr : file_start;
+            uint64_t copy_end = addr + 4096 < file_end ? addr + 4096 : file_end;
+            if (copy_start < copy_end) {
+                memcpy(phys_to_virt(phys_page + (copy_start - addr)),
+                       file_data + phdr[i].p_offset + (copy_start - file_start),
+                       copy_end - copy_start);
+            }
         }
 
-        add_memory_region(process, vaddr_start, size, (phdr[i].p_flags & PF_W) != 0,
-                          (phdr[i].p_flags & PF_X) != 0);
+        if (vaddr_start < highest_addr) vaddr_start = highest_addr;
+        if (vaddr_start < vaddr_end) {
+            insert_region(process, vaddr_start, vaddr_end - vaddr_start,
+                          (phdr[i].p_flags & PF_W) != 0, (phdr[i].p_flags & PF_X) != 0,
+                          RegionKind::Image);
+        }
 
         if (vaddr_end > highest_addr) highest_addr = vaddr_end;
     }
@@ -190,20 +217,12 @@ bool ProcessManager::load_program(Process* process, const char* path) {
 
 bool ProcessManager::setup_process_stack(Process* process, char* const argv[], char* const envp[]) {
     auto& vmm = VirtualMemoryManager::instance();
-    auto& pmm = PhysicalMemoryManager::instance();
 
-    uint64_t stack_pages = (USER_STACK_SIZE + 4095) / 4096;
-    uint64_t stack_bottom = USER_STACK_TOP - USER_STACK_SIZE;
+    if (!process->address_space) process->address_space = vmm.create_address_space();
+    if (!process->address_space) return false;
 
-    for (uint64_t i = 0; i < stack_pages; i++) {
-        uint64_t addr = stack_bottom + i * 4096;
-        uintptr_t phys_page = reinterpret_cast<uintptr_t>(pmm.allocate_frame());
-        if (!phys_page) {
-            cleanup_process_memory(process);
-            return false;
-        }
-        vmm.map_page(addr, phys_page, true);
-    }
+    MemoryRegion* stack_region = insert_region(process, USER_STACK_TOP - USER_STACK_SIZE,
+                                               USER_STACK_SIZE, true, false, RegionKind::Stack);
 
     process->user_stack = USER_STACK_TOP;
     uint64_t* stack_ptr = reinterpret_cast<uint64_t*>(USER_STACK_TOP);
@@ -230,6 +249,14 @@ bool ProcessManager::setup_process_stack(Process* process, char* const argv[], c
         return false;
     }
 
+    for (uint64_t addr = (USER_STACK_TOP - required_space) & ~0xFFFULL; addr < USER_STACK_TOP;
+         addr += 4096) {
+        if (!populate_page(process, stack_region, addr)) {
+            cleanup_process_memory(process);
+            return false;
+        }
+    }
+
     process->argv = new char*[argc + 1];
     for (int i = 0; i < argc; i++) {
         process->argv[i] = strdup(argv[i]);
@@ -244,6 +271,10 @@ bool ProcessManager::setup_process_stack(Process* process, char* const argv[], c
         process->envp[envc] = nullptr;
     }
 
+    AddressSpace* previous_space = vmm.get_active_address_space();
+    uint64_t flags = Spinlock::save_irq();
+    vmm.activate(process->address_space);
+
     stack_ptr = reinterpret_cast<uint64_t*>(USER_STACK_TOP - required_space);
     uint64_t current_ptr = reinterpret_cast<uint64_t>(stack_ptr);
 
@@ -265,6 +296,9 @@ bool ProcessManager::setup_process_stack(Process* process, char* const argv[], c
         stack_ptr += envc + 1;
     }
 
+    vmm.activate(previous_space);
+    Spinlock::restore_irq(flags);
+
     process->registers.rsp = current_ptr;
     process->registers.rbp = process->registers.rsp;
     process->registers.rip = process->entry_point;
@@ -273,8 +307,6 @@ bool ProcessManager::setup_process_stack(Process* process, char* const argv[], c
     process->registers.ss = 0x1B;
     process->registers.rflags = 0x202;
 
-    add_memory_region(process, USER_STACK_TOP - USER_STACK_SIZE, USER_STACK_SIZE, true, false);
-
     return true;
 }
 
@@ -283,9 +315,12 @@ void ProcessManager::switch_to_process(Process* process) {
         ((process->state != ProcessState::Running) && (process->state != ProcessState::Ready)))
         return;
 
-    if (m_current_process != process) {
-        Process* old = m_current_process;
-        m_current_process = process;
+    if (!process->registers.rsp) return;
+
+    Process*& running = current_slot();
+    if (running != process) {
+        Process* old = running;
+        running = process;
 
         if (old) {
             if (old->state == ProcessState::Running) old->state = ProcessState::Ready;
@@ -293,6 +328,8 @@ void ProcessManager::switch_to_process(Process* process) {
 
         process->state = ProcessState::Running;
 
+        VirtualMemoryManager::instance().activate(process->address_space);
+
         if (old)
             switch_context(&old->registers, &process->registers);
         else
@@ -302,41 +339,315 @@ void ProcessManager::switch_to_process(Process* process) {
 
 void ProcessManager::cleanup_process_memory(Process* process) {
     auto& vmm = VirtualMemoryManager::instance();
-    auto& pmm = PhysicalMemoryManager::instance();
 
-    MemoryRegion* region = process->memory_regions;
-    while (region) {
-        for (uint64_t addr = region->start; addr < region->start + region->size; addr += 4096) {
-            uintptr_t phys_addr = vmm.get_physical_address(addr);
-            if (phys_addr) {
-                pmm.free_frame(reinterpret_cast<void*>(phys_addr));
-                vmm.unmap_page(addr);
-            }
-        }
+    TLBFlushBatch batch;
 
-        auto* next = region->next;
-        delete region;
-        region = next;
-    }
+    release_memory(process->address_space, process->regions);
 
-    process->memory_regions = nullptr;
+    process->address_space = nullptr;
     process->brk = 0;
     process->program_break = 0;
+    process->resident_pages = 0;
 
     if (process->kernel_stack) {
-        uint64_t kernel_stack_pages = (KERNEL_STACK_SIZE + 4095) / 4096;
         uint64_t kernel_stack_base = process->kernel_stack - KERNEL_STACK_SIZE;
+        vmm.unmap_range(kernel_stack_base, KERNEL_STACK_SIZE, true);
+        process->kernel_stack = 0;
+    }
+}
 
-        for (uint64_t i = 0; i < kernel_stack_pages; i++) {
-            uint64_t addr = kernel_stack_base + i * 4096;
-            uintptr_t phys_addr = vmm.get_physical_address(addr);
-            if (phys_addr) {
-                pmm.free_frame(reinterpret_cast<void*>(phys_addr));
-                vmm.unmap_page(addr);
-            }
+void ProcessManager::release_memory(AddressSpace* space, RegionTree& regions) {
+    TLBFlushBatch batch;
+
+    if (space) {
+        for (MemoryRegion* region = regions.first(); region; region = RegionTree::next(region))
+            release_pages(space, region->start, region->end());
+    }
+    regions.clear();
+
+    batch.flush();
+    VirtualMemoryManager::instance().destroy_address_space(space);
+}
+
+bool ProcessManager::clone_memory(Process* parent, Process* child) {
+    auto& vmm = VirtualMemoryManager::instance();
+
+    if (!child->address_space) child->address_space = vmm.create_address_space();
+    if (!child->address_space) return false;
+
+    for (MemoryRegion* region = parent->regions.first(); region;
+         region = RegionTree::next(region)) {
+        auto* copy = new MemoryRegion;
+        copy->start = region->start;
+        copy->size = region->size;
+        copy->writable = region->writable;
+        copy->executable = region->executable;
+        copy->kind = region->kind;
+        child->regions.insert(copy);
+
+        if (!parent->address_space) continue;
+
+        if (!vmm.share_range(parent->address_space, child->address_space, region->start,
+                             region->size))
+            return false;
+    }
+
+    child->brk = parent->brk;
+    child->program_break = parent->program_break;
+    child->resident_pages = parent->resident_pages;
+    return true;
+}
+
+bool ProcessManager::handle_page_fault(uint64_t address, uint64_t error_code) {
+    auto& vmm = VirtualMemoryManager::instance();
+    if (!vmm.is_user_address(address)) return false;
+
+    Process* process = find_process(vmm.get_active_address_space());
+    if (!process) return false;
+
+    MemoryRegion* region = process->regions.find(address);
+    if (!region) return false;
+    if ((error_code & FAULT_WRITE) && !region->writable) return false;
+    if ((error_code & FAULT_INSTRUCTION) && !region->executable) return false;
+
+    if (error_code & FAULT_PRESENT) {
+        if (!(error_code & FAULT_WRITE)) return false;
+        return vmm.resolve_copy_on_write(process->address_space, address);
+    }
+
+    return populate_page(process, region, address);
+}
+
+bool ProcessManager::set_break(Process* process, uint64_t new_break) {
+    if (new_break < process->program_break) return false;
+
+    uint64_t heap_start = (process->program_break + 0xFFF) & ~0xFFFULL;
+    uint64_t new_end = (new_break + 0xFFF) & ~0xFFFULL;
+    uint64_t old_end = (process->brk + 0xFFF) & ~0xFFFULL;
+    if (new_end < heap_start) new_end = heap_start;
+    if (old_end < heap_start) old_end = heap_start;
+    if (new_end > USER_MMAP_BASE) return false;
+
+    if (new_end > old_end) {
+        MemoryRegion* next = process->regions.lower_bound(old_end);
+        if (next && next->start < new_end) return false;
+    }
+
+    MemoryRegion* heap = old_end > heap_start ? process->regions.find(old_end - 1) : nullptr;
+    if (heap && heap->kind != RegionKind::Heap) heap = nullptr;
+
+    if (new_end < old_end) {
+        process->resident_pages -= release_pages(process->address_space, new_end, old_end);
+        if (heap && new_end <= heap->start) {
+            process->regions.remove(heap);
+            delete heap;
+        } else if (heap)
+            heap->size = new_end - heap->start;
+    } else if (new_end > old_end) {
+        if (heap)
+            heap->size = new_end - heap->start;
+        else
+            insert_region(process, old_end, new_end - old_end, true, false, RegionKind::Heap);
+    }
+
+    process->brk = new_break;
+    return true;
+}
+
+uint64_t ProcessManager::map_anonymous(Process* process, uint64_t address, uint64_t length,
+                                       bool writable, bool executable, bool fixed) {
+    length = (length + 0xFFF) & ~0xFFFULL;
+    if (length == 0) return 0;
+
+    if (fixed) {
+        if ((address & 0xFFF) || address + length < address) return 0;
+        auto& vmm = VirtualMemoryManager::instance();
+        if (!vmm.is_user_address(address) || !vmm.is_user_address(address + length - 1))
+            return 0;
+
+        unmap_memory(process, address, length);
+    } else {
+        address = find_free_range(process, length, address);
+        if (!address) return 0;
+    }
+
+    insert_region(process, address, length, writable, executable, RegionKind::Anonymous);
+    return address;
+}
+
+bool ProcessManager::unmap_memory(Process* process, uint64_t address, uint64_t length) {
+    uint64_t end = address + ((length + 0xFFF) & ~0xFFFULL);
+    if ((address & 0xFFF) || end <= address) return false;
+
+    MemoryRegion* region = process->regions.lower_bound(address);
+    while (region && region->start < end) {
+        if (region->start < address) {
+            split_region(process, region, address);
+            region = RegionTree::next(region);
+            continue;
         }
-        process->kernel_stack = 0;
+        if (region->end() > end) split_region(process, region, end);
+
+        MemoryRegion* next = RegionTree::next(region);
+        if (process->address_space)
+            process->resident_pages -=
+                release_pages(process->address_space, region->start, region->end());
+        process->regions.remove(region);
+        delete region;
+        region = next;
+    }
+
+    return true;
+}
+
+bool ProcessManager::protect_memory(Process* process, uint64_t address, uint64_t length,
+                                    bool writable, bool executable) {
+    uint64_t end = address + ((length + 0xFFF) & ~0xFFFULL);
+    if ((address & 0xFFF) || end <= address) return false;
+
+    uint64_t covered = address;
+    for (MemoryRegion* region = process->regions.lower_bound(address);
+         region && region->start < end; region = RegionTree::next(region)) {
+        if (region->start > covered) return false;
+        covered = region->end();
+    }
+    if (covered < end) return false;
+
+    auto& vmm = VirtualMemoryManager::instance();
+
+    MemoryRegion* region = process->regions.lower_bound(address);
+    while (region && region->start < end) {
+        if (region->start < address) {
+            split_region(process, region, address);
+            region = RegionTree::next(region);
+            continue;
+        }
+        if (region->end() > end) split_region(process, region, end);
+
+        region->writable = writable;
+        region->executable = executable;
+        if (process->address_space)
+            vmm.protect_range(process->address_space, region->start, region->size, writable,
+                              executable);
+        region = RegionTree::next(region);
+    }
+
+    region = process->regions.find(address);
+    while (region && region->start < end)
+        region = RegionTree::next(merge_region(process, region));
+
+    return true;
+}
+
+uint64_t ProcessManager::get_virtual_size(const Process* process) const {
+    uint64_t size = 0;
+    for (const MemoryRegion* region = process->regions.first(); region;
+         region = RegionTree::next(region))
+        size += region->size;
+    return size;
+}
+
+Process* ProcessManager::find_process(const AddressSpace* space) {
+    if (!space) return nullptr;
+    Process* running = current_slot();
+    if (running && running->address_space == space) return running;
+
+    for (Process* process = m_first_process; process; process = process->next) {
+        if (process->address_space == space) return process;
+    }
+    return nullptr;
+}
+
+MemoryRegion* ProcessManager::insert_region(Process* process, uint64_t start, uint64_t size,
+                                            bool writable, bool executable, RegionKind kind) {
+    auto* region = new MemoryRegion;
+    region->start = start;
+    region->size = size;
+    region->writable = writable;
+    region->executable = executable;
+    region->kind = kind;
+
+    process->regions.insert(region);
+    return merge_region(process, region);
+}
+
+MemoryRegion* ProcessManager::merge_region(Process* process, MemoryRegion* region) {
+    MemoryRegion* prev = RegionTree::prev(region);
+    if (prev && prev->end() == region->start && prev->compatible(*region)) {
+        prev->size += region->size;
+        process->regions.remove(region);
+        delete region;
+        region = prev;
+    }
+
+    MemoryRegion* next = RegionTree::next(region);
+    if (next && region->end() == next->start && region->compatible(*next)) {
+        region->size += next->size;
+        process->regions.remove(next);
+        delete next;
+    }
+
+    return region;
+}
+
+MemoryRegion* ProcessManager::split_region(Process* process, MemoryRegion* region,
+                                           uint64_t address) {
+    auto* upper = new MemoryRegion;
+    upper->start = address;
+    upper->size = region->end() - address;
+    upper->writable = region->writable;
+    upper->executable = region->executable;
+    upper->kind = region->kind;
+
+    region->size = address - region->start;
+    process->regions.insert(upper);
+    return upper;
+}
+
+uint64_t ProcessManager::find_free_range(Process* process, uint64_t length, uint64_t hint) {
+    auto in_window = [&](uint64_t address) {
+        return address >= USER_MMAP_BASE && address <= USER_MMAP_END - length;
+    };
+
+    if (length > USER_MMAP_END - USER_MMAP_BASE) return 0;
+
+    if (hint && !(hint & 0xFFF) && in_window(hint)) {
+        MemoryRegion* next = process->regions.lower_bound(hint);
+        if (!next || next->start >= hint + length) return hint;
     }
+
+    uint64_t candidate = USER_MMAP_BASE;
+    for (MemoryRegion* region = process->regions.lower_bound(candidate); region;
+         region = RegionTree::next(region)) {
+        if (region->start >= candidate + length) break;
+        if (region->end() > candidate) candidate = region->end();
+    }
+
+    return in_window(candidate) ? candidate : 0;
+}
+
+bool ProcessManager::populate_page(Process* process, MemoryRegion* region, uint64_t address) {
+    auto& vmm = VirtualMemoryManager::instance();
+    uint64_t page = address & ~0xFFFULL;
+    if (vmm.get_physical_address(process->address_space, page)) return true;
+
+    void* frame = PhysicalMemoryManager::instance().allocate_zeroed_frame();
+    if (!frame) return false;
+
+    if (!vmm.map_page(process->address_space, page, reinterpret_cast<uintptr_t>(frame),
+                      region->writable, region->executable)) {
+        PhysicalMemoryManager::instance().free_frame(frame);
+        return false;
+    }
+
+    process->resident_pages++;
+    return true;
+}
+
+size_t ProcessManager::release_pages(AddressSpace* space, uint64_t start, uint64_t end) {
+    start &= ~0xFFFULL;
+    end = (end + 0xFFF) & ~0xFFFULL;
+    return VirtualMemoryManager::instance().release_range(space, start, end - start);
 }
 
 }  // namespace kernel
\ No newline at end of file
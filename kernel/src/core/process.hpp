@@ -1,8 +1,14 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 #include "elf.hpp"
+#include "hw/smp.hpp"
+#include "lib/avl_tree.hpp"
+#include "vma.hpp"
+
+struct AddressSpace;
 
 namespace kernel {
 
@@ -39,12 +45,10 @@ struct RegisterState {
     uint64_t ss = 0;
 };
 
-struct MemoryRegion {
-    uint64_t start = 0;
-    uint64_t size = 0;
-    bool writable = false;
-    bool executable = false;
-    MemoryRegion* next = nullptr;
+struct Process;
+
+struct RunNode : AVLNode {
+    Process* process = nullptr;
 };
 
 struct Process {
@@ -55,9 +59,11 @@ struct Process {
     Process* next = nullptr;
 
     uint64_t entry_point = 0;
-    MemoryRegion* memory_regions = nullptr;
+    AddressSpace* address_space = nullptr;
+    RegionTree regions;
     uint64_t brk = 0;
     uint64_t program_break = 0;
+    uint64_t resident_pages = 0;
 
     RegisterState registers;
     uint64_t kernel_stack = 0;
@@ -71,6 +77,17 @@ struct Process {
     uint64_t total_runtime = 0;
     uint64_t last_run = 0;
     void* waiting_on = nullptr;
+
+    Process* run_next = nullptr;
+    Process* run_prev = nullptr;
+    RunNode run_node;
+    uint64_t vruntime = 0;
+    uint32_t cpu = 0;
+    uint8_t run_level = 0;
+    bool queued = false;
+
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
 };
 
 class ProcessManager {
@@ -84,28 +101,55 @@ public:
         return m_first_process;
     }
     Process* get_current_process() {
-        return m_current_process;
+        return current_slot();
     }
     void set_current_process(Process* process) {
-        m_current_process = process;
+        current_slot() = process;
     }
 
     bool load_program(Process* process, const char* path);
     void cleanup_process_memory(Process* process);
+    void release_memory(AddressSpace* space, RegionTree& regions);
+    bool clone_memory(Process* parent, Process* child);
     bool setup_process_stack(Process* process, char* const argv[], char* const envp[]);
     void switch_to_process(Process* process);
 
+    bool handle_page_fault(uint64_t address, uint64_t error_code);
+    bool set_break(Process* process, uint64_t new_break);
+    uint64_t map_anonymous(Process* process, uint64_t address, uint64_t length, bool writable,
+                           bool executable, bool fixed);
+    bool unmap_memory(Process* process, uint64_t address, uint64_t length);
+    bool protect_memory(Process* process, uint64_t address, uint64_t length, bool writable,
+                        bool executable);
+    uint64_t get_virtual_size(const Process* process) const;
+
 private:
     ProcessManager() = default;
     ~ProcessManager() = default;
 
+    Process*& current_slot();
+    Process* find_process(const AddressSpace* space);
+    MemoryRegion* insert_region(Process* process, uint64_t start, uint64_t size, bool writable,
+                                bool executable, RegionKind kind);
+    MemoryRegion* merge_region(Process* process, MemoryRegion* region);
+    MemoryRegion* split_region(Process* process, MemoryRegion* region, uint64_t address);
+    uint64_t find_free_range(Process* process, uint64_t length, uint64_t hint);
+    bool populate_page(Process* process, MemoryRegion* region, uint64_t address);
+    size_t release_pages(AddressSpace* space, uint64_t start, uint64_t end);
+
     Process* m_first_process = nullptr;
-    Process* m_current_process = nullptr;
+    Process* m_current_processes[MAX_CPUS] = {};
     pid_t m_next_pid = 1;
 
     static constexpr uint64_t USER_STACK_SIZE = 8 * 1024 * 1024;
     static constexpr uint64_t KERNEL_STACK_SIZE = 16 * 1024;
-    static constexpr uint64_t USER_STACK_TOP = 0x7FFFFFFFFFFF;
+    static constexpr uint64_t USER_STACK_TOP = 0x7FFFFFFFF000;
+    static constexpr uint64_t USER_MMAP_BASE = 0x600000000000;
+    static constexpr uint64_t USER_MMAP_END = 0x700000000000;
+
+    static constexpr uint64_t FAULT_PRESENT = 1 << 0;
+    static constexpr uint64_t FAULT_WRITE = 1 << 1;
+    static constexpr uint64_t FAULT_INSTRUCTION = 1 << 4;
 };
 
 }  // namespace kernel
\ No newline at end of file
@@ -9,8 +9,46 @@ namespace kernel {
 
 namespace {
 extern "C" void switch_context(RegisterState* old_state, RegisterState* new_state);
+
+constexpr uint32_t PRIORITY_WEIGHTS[CPURunQueue::PRIORITY_LEVELS] = {
+    335, 419, 524, 655, 819, 1024, 1280, 1600, 2000, 2500, 3125,
+};
+
+Process* fair_task(AVLNode* node) {
+    return node ? static_cast<RunNode*>(node)->process : nullptr;
+}
+
+bool runs_before(const AVLNode* a, const AVLNode* b) {
+    const Process* left = static_cast<const RunNode*>(a)->process;
+    const Process* right = static_cast<const RunNode*>(b)->process;
+    if (left->vruntime != right->vruntime) return left->vruntime < right->vruntime;
+    return left->pid < right->pid;
+}
+
+uint64_t lock_pair(CPURunQueue* a, CPURunQueue* b) {
+    if (a > b) {
+        CPURunQueue* tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    uint64_t flags = a->lock.lock_irqsave();
+    if (b != a) b->lock.lock();
+    return flags;
 }
 
+void unlock_pair(CPURunQueue* a, CPURunQueue* b, uint64_t flags) {
+    if (a > b) {
+        CPURunQueue* tmp = a;
+        a = b;
+        b = tmp;
+    }
+
+    if (b != a) b->lock.unlock();
+    a->lock.unlock_irqrestore(flags);
+}
+}  // namespace
+
 Scheduler& Scheduler::instance() {
     static Scheduler instance;
     return instance;
@@ -18,7 +56,6 @@ Scheduler& Scheduler::instance() {
 
 void Scheduler::initialize(SchedulerPolicy policy) {
     m_policy = policy;
-    m_load_balance_counter = 0;
 
     auto& smp = SMPManager::instance();
     uint32_t cpu_count = smp.get_cpu_count();
@@ -27,7 +64,7 @@ void Scheduler::initialize(SchedulerPolicy policy) {
 
     for (uint32_t i = 0; i < cpu_count; i++) {
         CPURunQueue runqueue;
-        runqueue.current_index = 0;
+        runqueue.policy = policy;
         runqueue.current_time_slice = DEFAULT_TIME_SLICE;
         runqueue.current = nullptr;
         runqueue.cpu_id = i;
@@ -40,53 +77,70 @@ void Scheduler::initialize(SchedulerPolicy policy) {
 void Scheduler::add_process(Process* process) {
     if (!process) return;
 
-    uint32_t target_cpu = 0;
-    size_t min_queue_size = SIZE_MAX;
+    uint64_t flags;
+    CPURunQueue* owner = lock_task_runqueue(process, flags);
+    if (owner) {
+        bool active = process->queued || owner->current == process;
+        owner->lock.unlock_irqrestore(flags);
+        if (active) return;
+    }
+
+    CPURunQueue* runqueue = nullptr;
+    size_t min_running = SIZE_MAX;
+    uint64_t min_load = UINT64_MAX;
 
     for (size_t i = 0; i < m_runqueues.size(); i++) {
-        if (m_runqueues[i].process_queue.size() < min_queue_size) {
-            min_queue_size = m_runqueues[i].process_queue.size();
-            target_cpu = m_runqueues[i].cpu_id;
+        size_t running = nr_running(&m_runqueues[i]);
+        uint64_t load = runqueue_load(&m_runqueues[i]);
+        if (running < min_running || (running == min_running && load < min_load)) {
+            min_running = running;
+            min_load = load;
+            runqueue = &m_runqueues[i];
         }
     }
 
-    CPURunQueue* runqueue = get_runqueue(target_cpu);
     if (!runqueue) return;
 
-    for (size_t i = 0; i < runqueue->process_queue.size(); i++) {
-        if (runqueue->process_queue[i] == process) return;
-    }
+    flags = runqueue->lock.lock_irqsave();
+    if (!process->queued) wake_process(runqueue, process);
+    bool kick = runqueue->needs_resched || !runqueue->current;
+    runqueue->lock.unlock_irqrestore(flags);
 
-    process->state = ProcessState::Ready;
-    runqueue->process_queue.push_back(process);
+    auto& smp = SMPManager::instance();
+    if (runqueue->cpu_id == smp.get_current_cpu_id())
+        update_tick(runqueue->cpu_id);
+    else if (kick)
+        smp.send_ipi(runqueue->cpu_id, IPI_VECTOR);
 }
 
 void Scheduler::remove_process(Process* process) {
     if (!process) return;
 
-    for (size_t i = 0; i < m_runqueues.size(); i++) {
-        auto& runqueue = m_runqueues[i];
+    uint64_t flags;
+    CPURunQueue* runqueue = lock_task_runqueue(process, flags);
+    if (!runqueue) return;
 
-        for (size_t j = 0; j < runqueue.process_queue.size(); j++) {
-            if (runqueue.process_queue[j] == process) {
-                if (runqueue.current_index >= j)
-                    if (runqueue.current_index > 0) runqueue.current_index--;
+    if (process->queued) dequeue(runqueue, process);
 
-                for (size_t k = j; k < runqueue.process_queue.size() - 1; k++) {
-                    runqueue.process_queue[k] = runqueue.process_queue[k + 1];
-                }
+    if (runqueue->current == process) {
+        runqueue->current = nullptr;
+        runqueue->needs_resched = true;
+    }
 
-                runqueue.process_queue.pop_back();
+    runqueue->lock.unlock_irqrestore(flags);
+}
 
-                if (runqueue.current == process) {
-                    runqueue.current = nullptr;
-                    runqueue.needs_resched = true;
-                }
+void Scheduler::block_process(Process* process) {
+    if (!process) return;
 
-                return;
-            }
-        }
-    }
+    uint64_t flags;
+    CPURunQueue* runqueue = lock_task_runqueue(process, flags);
+
+    process->state = ProcessState::Waiting;
+    if (!runqueue) return;
+
+    if (process->queued) dequeue(runqueue, process);
+    runqueue->lock.unlock_irqrestore(flags);
 }
 
 void Scheduler::schedule() {
@@ -100,114 +154,276 @@ void Scheduler::schedule_on_cpu(uint32_t cpu_id) {
     CPURunQueue* runqueue = get_runqueue(cpu_id);
     if (!runqueue) return;
 
-    Process* next_process = select_next_process(runqueue);
+    uint64_t flags = runqueue->lock.lock_irqsave();
+    Process* next_process = pick_next_process(runqueue);
+    bool idle = !runqueue->current;
+    runqueue->lock.unlock_irqrestore(flags);
+
+    if (idle && idle_balance(m_runqueues.begin(), m_runqueues.size(), runqueue)) {
+        flags = runqueue->lock.lock_irqsave();
+        next_process = pick_next_process(runqueue);
+        runqueue->lock.unlock_irqrestore(flags);
+    }
+
+    update_tick(cpu_id);
+
     if (!next_process) return;
 
-    auto& pm = ProcessManager::instance();
+    ProcessManager::instance().switch_to_process(next_process);
+}
+
+void Scheduler::wake_process(CPURunQueue* runqueue, Process* process) {
+    if (runqueue->policy == SchedulerPolicy::Fair) {
+        uint64_t floor = runqueue->min_vruntime;
+        if (process->total_runtime && floor > SLEEPER_CREDIT) floor -= SLEEPER_CREDIT;
+        if (process->vruntime < floor) process->vruntime = floor;
+    }
+
+    process->state = ProcessState::Ready;
+    enqueue(runqueue, process);
+
+    Process* current = runqueue->current;
+    if (runqueue->policy == SchedulerPolicy::Fair && current &&
+        process->vruntime + WAKEUP_GRANULARITY < current->vruntime)
+        runqueue->needs_resched = true;
+}
+
+Process* Scheduler::pick_next_process(CPURunQueue* runqueue) {
     Process* current = runqueue->current;
+    bool runnable = current && (current->state == ProcessState::Running ||
+                                current->state == ProcessState::Ready);
 
-    if (current == next_process) return;
+    runqueue->needs_resched = false;
+
+    Process* next_process = select_next_process(runqueue);
+    if (!next_process || (runnable && !should_preempt(runqueue, next_process, current))) {
+        if (runnable)
+            runqueue->current_time_slice = time_slice(runqueue, current);
+        else
+            runqueue->current = nullptr;
+        return nullptr;
+    }
+
+    dequeue(runqueue, next_process);
+    if (runnable) {
+        current->state = ProcessState::Ready;
+        enqueue(runqueue, current);
+    }
 
-    runqueue->current_time_slice = DEFAULT_TIME_SLICE;
     runqueue->current = next_process;
+    runqueue->current_time_slice = time_slice(runqueue, next_process);
+    update_min_vruntime(runqueue);
 
+    next_process->cpu = runqueue->cpu_id;
     next_process->last_run = get_ticks();
+    next_process->state = ProcessState::Running;
 
-    if (current) current->state = ProcessState::Ready;
+    return next_process;
+}
 
-    next_process->state = ProcessState::Running;
+bool Scheduler::account_tick(CPURunQueue* runqueue, uint64_t ticks) {
+    uint64_t runnable = runnable_weight(runqueue);
+    for (uint64_t i = 0; i < ticks && i < LOAD_DECAY * 4; i++)
+        runqueue->load_avg = (runqueue->load_avg * (LOAD_DECAY - 1) + runnable) / LOAD_DECAY;
 
-    pm.switch_to_process(next_process);
+    Process* current = runqueue->current;
+    if (!current) return false;
+
+    current->total_runtime += ticks;
+
+    if (runqueue->policy == SchedulerPolicy::Fair) {
+        current->vruntime += ticks * VRUNTIME_SCALE * NICE_0_WEIGHT / weight(current);
+        update_min_vruntime(runqueue);
+    } else if (current->priority >= 9)
+        return false;
+
+    if (runqueue->current_time_slice > ticks)
+        runqueue->current_time_slice -= ticks;
+    else
+        runqueue->current_time_slice = 0;
+    if (runqueue->current_time_slice == 0) runqueue->needs_resched = true;
+
+    return runqueue->needs_resched;
 }
 
-void Scheduler::tick() {
+void Scheduler::tick(uint64_t ticks) {
     auto& smp = SMPManager::instance();
     uint32_t current_cpu = smp.get_current_cpu_id();
 
-    tick_on_cpu(current_cpu);
-
-    m_load_balance_counter++;
-    if (m_load_balance_counter >= LOAD_BALANCE_PERIOD) {
-        m_load_balance_counter = 0;
-
-        if (current_cpu == 0) load_balance();
+    CPURunQueue* runqueue = get_runqueue(current_cpu);
+    if (runqueue) {
+        balance_tick(m_runqueues.begin(), m_runqueues.size(), runqueue, ticks);
+        if (!runqueue->balance_ticks && runqueue->nr_queued) kick_idle_cpu(runqueue);
     }
+
+    tick_on_cpu(current_cpu, ticks);
 }
 
-void Scheduler::tick_on_cpu(uint32_t cpu_id) {
-    uint64_t flags;
-    __asm__ volatile("pushfq; pop %0" : "=r"(flags));
-    if (!(flags & (1 << 9))) return;
+void Scheduler::tick_on_cpu(uint32_t cpu_id, uint64_t ticks) {
+    CPURunQueue* runqueue = get_runqueue(cpu_id);
+    if (!runqueue) return;
+
+    uint64_t flags = runqueue->lock.lock_irqsave();
+    bool resched = account_tick(runqueue, ticks);
+    runqueue->lock.unlock_irqrestore(flags);
 
+    auto& smp = SMPManager::instance();
+    if (cpu_id != smp.get_current_cpu_id()) {
+        if (resched) smp.send_ipi(cpu_id, IPI_VECTOR);
+    } else if (resched)
+        schedule_on_cpu(cpu_id);
+    else
+        update_tick(cpu_id);
+}
+
+void Scheduler::update_tick(uint32_t cpu_id) {
     CPURunQueue* runqueue = get_runqueue(cpu_id);
     if (!runqueue) return;
 
-    Process* current = runqueue->current;
+    uint64_t flags = runqueue->lock.lock_irqsave();
+    uint64_t ticks = next_tick(runqueue);
+    runqueue->lock.unlock_irqrestore(flags);
+
+    SMPManager::instance().set_next_tick(ticks);
+}
 
-    if (!current) return;
+Process* Scheduler::select_next_process(CPURunQueue* runqueue) {
+    if (!runqueue) return nullptr;
 
-    current->total_runtime++;
+    if (runqueue->policy == SchedulerPolicy::Fair) return fair_task(runqueue->fair_tasks.first());
 
-    if (current->priority >= 9) return;
+    if (!runqueue->ready_bitmap) return nullptr;
 
-    if (runqueue->current_time_slice > 0) runqueue->current_time_slice--;
+    uint32_t level = 31 - __builtin_clz(runqueue->ready_bitmap);
+    return runqueue->levels[level].head;
+}
 
-    if (runqueue->current_time_slice == 0) {
-        runqueue->needs_resched = true;
+uint8_t Scheduler::queue_level(const CPURunQueue* runqueue, const Process* process) const {
+    return runqueue->policy == SchedulerPolicy::Priority ? process->priority : 0;
+}
 
-        auto& smp = SMPManager::instance();
-        if (cpu_id == smp.get_current_cpu_id())
-            schedule_on_cpu(cpu_id);
-        else
-            smp.send_ipi(cpu_id, IPI_VECTOR);
+bool Scheduler::should_preempt(const CPURunQueue* runqueue, const Process* next,
+                               const Process* current) const {
+    switch (runqueue->policy) {
+        case SchedulerPolicy::RoundRobin:
+            return true;
+
+        case SchedulerPolicy::Priority:
+            return queue_level(runqueue, next) >= queue_level(runqueue, current);
+
+        case SchedulerPolicy::Fair:
+            return next->vruntime < current->vruntime;
     }
+
+    return true;
 }
 
-Process* Scheduler::select_next_process(CPURunQueue* runqueue) {
-    if (!runqueue || runqueue->process_queue.size() == 0) return nullptr;
+uint64_t Scheduler::time_slice(const CPURunQueue* runqueue, const Process* process) const {
+    if (runqueue->policy != SchedulerPolicy::Fair) return DEFAULT_TIME_SLICE;
 
-    Process* selected = nullptr;
+    uint64_t period = nr_running(runqueue) * MIN_GRANULARITY;
+    if (period < TARGET_LATENCY) period = TARGET_LATENCY;
 
-    switch (m_policy) {
-        case SchedulerPolicy::RoundRobin: {
-            size_t start_index = runqueue->current_index;
+    uint64_t total_weight = runnable_weight(runqueue);
+    if (!total_weight) return period;
 
-            do {
-                runqueue->current_index =
-                    (runqueue->current_index + 1) % runqueue->process_queue.size();
+    uint64_t slice = period * weight(process) / total_weight;
+    return slice > MIN_GRANULARITY ? slice : MIN_GRANULARITY;
+}
 
-                if (runqueue->process_queue[runqueue->current_index]->state ==
-                    ProcessState::Ready) {
-                    selected = runqueue->process_queue[runqueue->current_index];
-                    break;
-                }
+uint64_t Scheduler::next_tick(const CPURunQueue* runqueue) const {
+    if (!runqueue->current) return runqueue->nr_queued ? 1 : 0;
+    if (runqueue->needs_resched) return 1;
 
-            } while (runqueue->current_index != start_index && !selected);
+    uint64_t balance = runqueue->balance_ticks < LOAD_BALANCE_PERIOD
+                           ? LOAD_BALANCE_PERIOD - runqueue->balance_ticks
+                           : 1;
+    if (!runqueue->nr_queued) return balance;
 
-            break;
-        }
+    uint64_t slice = runqueue->current_time_slice ? runqueue->current_time_slice : 1;
+    return slice < balance ? slice : balance;
+}
 
-        case SchedulerPolicy::Priority: {
-            uint8_t highest_priority = 0;
-            size_t index = 0;
+void Scheduler::update_min_vruntime(CPURunQueue* runqueue) {
+    if (runqueue->policy != SchedulerPolicy::Fair) return;
 
-            for (size_t i = 0; i < runqueue->process_queue.size(); i++) {
-                auto* process = runqueue->process_queue[i];
+    uint64_t vruntime = UINT64_MAX;
+    if (runqueue->current) vruntime = runqueue->current->vruntime;
 
-                if (process->state == ProcessState::Ready && process->priority > highest_priority) {
-                    highest_priority = process->priority;
-                    selected = process;
-                    index = i;
-                }
-            }
+    Process* first = fair_task(runqueue->fair_tasks.first());
+    if (first && first->vruntime < vruntime) vruntime = first->vruntime;
 
-            if (selected) runqueue->current_index = index;
+    if (vruntime != UINT64_MAX && vruntime > runqueue->min_vruntime)
+        runqueue->min_vruntime = vruntime;
+}
 
-            break;
-        }
+uint32_t Scheduler::weight(const Process* process) {
+    uint8_t priority = process->priority > MAX_PRIORITY ? MAX_PRIORITY : process->priority;
+    return PRIORITY_WEIGHTS[priority];
+}
+
+void Scheduler::enqueue(CPURunQueue* runqueue, Process* process) {
+    if (runqueue->policy == SchedulerPolicy::Fair) {
+        process->run_node.process = process;
+        runqueue->fair_tasks.insert(&process->run_node, runs_before);
+    } else {
+        uint8_t level = queue_level(runqueue, process);
+        RunList& list = runqueue->levels[level];
+
+        process->run_next = nullptr;
+        process->run_prev = list.tail;
+        if (list.tail)
+            list.tail->run_next = process;
+        else
+            list.head = process;
+        list.tail = process;
+
+        process->run_level = level;
+        runqueue->ready_bitmap |= 1U << level;
     }
 
-    return selected;
+    process->cpu = runqueue->cpu_id;
+    process->queued = true;
+    runqueue->queued_weight += weight(process);
+    runqueue->nr_queued++;
+}
+
+void Scheduler::dequeue(CPURunQueue* runqueue, Process* process) {
+    if (runqueue->policy == SchedulerPolicy::Fair) {
+        runqueue->fair_tasks.remove(&process->run_node);
+    } else {
+        RunList& list = runqueue->levels[process->run_level];
+
+        if (process->run_prev)
+            process->run_prev->run_next = process->run_next;
+        else
+            list.head = process->run_next;
+
+        if (process->run_next)
+            process->run_next->run_prev = process->run_prev;
+        else
+            list.tail = process->run_prev;
+
+        process->run_next = process->run_prev = nullptr;
+        if (!list.head) runqueue->ready_bitmap &= ~(1U << process->run_level);
+    }
+
+    process->queued = false;
+    runqueue->queued_weight -= weight(process);
+    runqueue->nr_queued--;
+}
+
+size_t Scheduler::nr_running(const CPURunQueue* runqueue) const {
+    return runqueue->nr_queued + (runqueue->current ? 1 : 0);
+}
+
+uint64_t Scheduler::runnable_weight(const CPURunQueue* runqueue) const {
+    Process* current = runqueue->current;
+    return runqueue->queued_weight + (current ? weight(current) : 0);
+}
+
+uint64_t Scheduler::runqueue_load(const CPURunQueue* runqueue) const {
+    return (runqueue->load_avg + runnable_weight(runqueue)) / 2;
 }
 
 void Scheduler::set_process_priority(pid_t pid, uint8_t priority) {
@@ -215,9 +431,17 @@ void Scheduler::set_process_priority(pid_t pid, uint8_t priority) {
     Process* process = pm.get_process(pid);
 
     if (process) {
-        if (priority > 10) priority = 10;
+        if (priority > MAX_PRIORITY) priority = MAX_PRIORITY;
+
+        uint64_t flags;
+        CPURunQueue* runqueue = lock_task_runqueue(process, flags);
+        bool queued = runqueue && process->queued;
+        if (queued) dequeue(runqueue, process);
 
         process->priority = priority;
+
+        if (queued) enqueue(runqueue, process);
+        if (runqueue) runqueue->lock.unlock_irqrestore(flags);
     }
 }
 
@@ -229,94 +453,145 @@ CPURunQueue* Scheduler::get_current_runqueue() {
 }
 
 CPURunQueue* Scheduler::get_runqueue(uint32_t cpu_id) {
-    for (size_t i = 0; i < m_runqueues.size(); i++) {
-        if (m_runqueues[i].cpu_id == cpu_id) return &m_runqueues[i];
-    }
+    if (cpu_id >= m_runqueues.size()) return nullptr;
 
-    return nullptr;
+    return &m_runqueues[cpu_id];
 }
 
-bool Scheduler::can_migrate_process(Process* process, uint32_t from_cpu, uint32_t to_cpu) {
-    (void)from_cpu;
+CPURunQueue* Scheduler::lock_task_runqueue(Process* process, uint64_t& flags) {
+    for (;;) {
+        CPURunQueue* runqueue = get_runqueue(process->cpu);
+        if (!runqueue) return nullptr;
+
+        flags = runqueue->lock.lock_irqsave();
+        if (process->cpu == runqueue->cpu_id) return runqueue;
+        runqueue->lock.unlock_irqrestore(flags);
+    }
+}
 
-    if (!process) return false;
+bool Scheduler::can_migrate_process(const Process* process,
+                                    const CPURunQueue* to_runqueue) const {
+    if (!process || !to_runqueue || !process->queued) return false;
 
     if (process->state == ProcessState::Running) return false;
 
     if (process->priority >= 8) return false;
 
-    CPURunQueue* to_runqueue = get_runqueue(to_cpu);
-    if (!to_runqueue) return false;
-
     return true;
 }
 
-void Scheduler::migrate_process(Process* process, uint32_t from_cpu, uint32_t to_cpu) {
-    if (!process || from_cpu == to_cpu) return;
+Process* Scheduler::find_migratable(CPURunQueue* from_runqueue, CPURunQueue* to_runqueue,
+                                    uint64_t max_weight) {
+    for (AVLNode* node = from_runqueue->fair_tasks.first(); node; node = AVLTree::next(node)) {
+        Process* process = fair_task(node);
+        if (weight(process) <= max_weight && can_migrate_process(process, to_runqueue))
+            return process;
+    }
 
-    CPURunQueue* from_runqueue = get_runqueue(from_cpu);
-    CPURunQueue* to_runqueue = get_runqueue(to_cpu);
+    for (size_t level = 0; level < CPURunQueue::PRIORITY_LEVELS; level++) {
+        for (Process* process = from_runqueue->levels[level].head; process;
+             process = process->run_next) {
+            if (weight(process) <= max_weight && can_migrate_process(process, to_runqueue))
+                return process;
+        }
+    }
 
-    if (!from_runqueue || !to_runqueue) return;
+    return nullptr;
+}
 
-    for (size_t i = 0; i < from_runqueue->process_queue.size(); i++) {
-        if (from_runqueue->process_queue[i] == process) {
-            if (from_runqueue->current_index >= i)
-                if (from_runqueue->current_index > 0) from_runqueue->current_index--;
+void Scheduler::migrate_process(Process* process, CPURunQueue* from_runqueue,
+                                CPURunQueue* to_runqueue) {
+    if (!process || from_runqueue == to_runqueue || !process->queued) return;
 
-            for (size_t j = i; j < from_runqueue->process_queue.size() - 1; j++) {
-                from_runqueue->process_queue[j] = from_runqueue->process_queue[j + 1];
-            }
+    dequeue(from_runqueue, process);
 
-            from_runqueue->process_queue.pop_back();
-            break;
-        }
+    if (to_runqueue->policy == SchedulerPolicy::Fair) {
+        int64_t lag = static_cast<int64_t>(process->vruntime - from_runqueue->min_vruntime);
+        if (lag < 0 && to_runqueue->min_vruntime < static_cast<uint64_t>(-lag)) lag = 0;
+        process->vruntime = to_runqueue->min_vruntime + lag;
     }
 
-    to_runqueue->process_queue.push_back(process);
+    enqueue(to_runqueue, process);
 }
 
-void Scheduler::load_balance() {
-    size_t max_processes = 0;
-    size_t min_processes = SIZE_MAX;
-    uint32_t max_cpu = 0;
-    uint32_t min_cpu = 0;
+bool Scheduler::idle_balance(CPURunQueue* runqueues, size_t count, CPURunQueue* idle) {
+    CPURunQueue* busiest = nullptr;
 
-    for (size_t i = 0; i < m_runqueues.size(); i++) {
-        size_t queue_size = m_runqueues[i].process_queue.size();
+    for (size_t i = 0; i < count; i++) {
+        CPURunQueue* runqueue = &runqueues[i];
+        if (runqueue == idle || !runqueue->nr_queued) continue;
 
-        if (queue_size > max_processes) {
-            max_processes = queue_size;
-            max_cpu = m_runqueues[i].cpu_id;
-        }
-
-        if (queue_size < min_processes) {
-            min_processes = queue_size;
-            min_cpu = m_runqueues[i].cpu_id;
-        }
+        if (!busiest || runqueue_load(runqueue) > runqueue_load(busiest)) busiest = runqueue;
     }
 
-    if (max_processes - min_processes <= 1) return;
+    if (!busiest) return false;
 
-    size_t to_move = (max_processes - min_processes) / 2;
+    uint64_t flags = lock_pair(idle, busiest);
 
-    CPURunQueue* max_runqueue = get_runqueue(max_cpu);
-    CPURunQueue* min_runqueue = get_runqueue(min_cpu);
+    Process* process = nullptr;
+    if (!idle->current && !idle->nr_queued) process = find_migratable(busiest, idle, UINT64_MAX);
+    if (process) migrate_process(process, busiest, idle);
 
-    if (!max_runqueue || !min_runqueue) return;
+    unlock_pair(idle, busiest, flags);
+
+    return process != nullptr;
+}
 
+size_t Scheduler::load_balance(CPURunQueue* runqueues, size_t count, CPURunQueue* target) {
+    CPURunQueue* busiest = nullptr;
+    uint64_t busiest_load = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        CPURunQueue* runqueue = &runqueues[i];
+        if (runqueue == target || !runqueue->nr_queued) continue;
+
+        uint64_t load = runqueue_load(runqueue);
+        if (load > busiest_load) {
+            busiest_load = load;
+            busiest = runqueue;
+        }
+    }
+
+    if (!busiest) return 0;
+
+    uint64_t flags = lock_pair(target, busiest);
+
+    uint64_t source_load = runqueue_load(busiest);
+    uint64_t target_load = runqueue_load(target);
     size_t moved = 0;
 
-    for (size_t i = 0; i < max_runqueue->process_queue.size() && moved < to_move; i++) {
-        Process* process = max_runqueue->process_queue[i];
+    if (source_load * 100 > target_load * IMBALANCE_PERCENT) {
+        uint64_t imbalance = (source_load - target_load) / 2;
 
-        if (can_migrate_process(process, max_cpu, min_cpu)) {
-            migrate_process(process, max_cpu, min_cpu);
+        while (Process* process = find_migratable(busiest, target, imbalance)) {
+            migrate_process(process, busiest, target);
+            imbalance -= weight(process);
             moved++;
-
-            i--;
         }
     }
+
+    unlock_pair(target, busiest, flags);
+
+    return moved;
+}
+
+void Scheduler::balance_tick(CPURunQueue* runqueues, size_t count, CPURunQueue* runqueue,
+                             uint64_t ticks) {
+    runqueue->balance_ticks += ticks;
+    if (runqueue->balance_ticks < LOAD_BALANCE_PERIOD) return;
+
+    runqueue->balance_ticks = 0;
+    load_balance(runqueues, count, runqueue);
+}
+
+void Scheduler::kick_idle_cpu(const CPURunQueue* busy) {
+    for (size_t i = 0; i < m_runqueues.size(); i++) {
+        CPURunQueue* runqueue = &m_runqueues[i];
+        if (runqueue == busy || runqueue->current || runqueue->nr_queued) continue;
+
+        SMPManager::instance().send_ipi(runqueue->cpu_id, IPI_VECTOR);
+        return;
+    }
 }
 
 }  // namespace kernel
\ No newline at end of file
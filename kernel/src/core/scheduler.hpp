@@ -3,6 +3,8 @@
 #include <cstdint>
 
 #include "hw/smp.hpp"
+#include "lib/avl_tree.hpp"
+#include "lib/spinlock.hpp"
 #include "lib/vector.hpp"
 #include "process.hpp"
 
@@ -13,15 +15,31 @@ struct Process;
 enum class SchedulerPolicy {
     RoundRobin,
     Priority,
+    Fair,
+};
+
+struct RunList {
+    Process* head = nullptr;
+    Process* tail = nullptr;
 };
 
 struct CPURunQueue {
-    Vector<Process*> process_queue;
-    size_t current_index = 0;
+    static constexpr size_t PRIORITY_LEVELS = 11;
+
+    SchedulerPolicy policy = SchedulerPolicy::RoundRobin;
+    RunList levels[PRIORITY_LEVELS];
+    uint32_t ready_bitmap = 0;
+    AVLTree fair_tasks;
+    uint64_t queued_weight = 0;
+    uint64_t load_avg = 0;
+    uint64_t min_vruntime = 0;
+    size_t nr_queued = 0;
     uint64_t current_time_slice = 0;
+    uint64_t balance_ticks = 0;
     Process* current = nullptr;
     uint32_t cpu_id = 0;
     bool needs_resched = false;
+    Spinlock lock;
 };
 
 class Scheduler {
@@ -34,13 +52,23 @@ public:
 
     void remove_process(Process* process);
 
+    void block_process(Process* process);
+
     void schedule();
 
     void schedule_on_cpu(uint32_t cpu_id);
 
-    void tick();
+    void tick(uint64_t ticks = 1);
+
+    void tick_on_cpu(uint32_t cpu_id, uint64_t ticks = 1);
+
+    void update_tick(uint32_t cpu_id);
+
+    void wake_process(CPURunQueue* runqueue, Process* process);
 
-    void tick_on_cpu(uint32_t cpu_id);
+    Process* pick_next_process(CPURunQueue* runqueue);
+
+    bool account_tick(CPURunQueue* runqueue, uint64_t ticks = 1);
 
     SchedulerPolicy get_policy() const {
         return m_policy;
@@ -52,7 +80,14 @@ public:
 
     CPURunQueue* get_runqueue(uint32_t cpu_id);
 
-    void load_balance();
+    bool idle_balance(CPURunQueue* runqueues, size_t count, CPURunQueue* idle);
+
+    size_t load_balance(CPURunQueue* runqueues, size_t count, CPURunQueue* target);
+
+    void balance_tick(CPURunQueue* runqueues, size_t count, CPURunQueue* runqueue,
+                      uint64_t ticks = 1);
+
+    uint64_t runqueue_load(const CPURunQueue* runqueue) const;
 
 private:
     Scheduler() = default;
@@ -63,18 +98,54 @@ private:
 
     Process* select_next_process(CPURunQueue* runqueue);
 
-    bool can_migrate_process(Process* process, uint32_t from_cpu, uint32_t to_cpu);
+    uint8_t queue_level(const CPURunQueue* runqueue, const Process* process) const;
+
+    bool should_preempt(const CPURunQueue* runqueue, const Process* next,
+                        const Process* current) const;
+
+    uint64_t time_slice(const CPURunQueue* runqueue, const Process* process) const;
 
-    void migrate_process(Process* process, uint32_t from_cpu, uint32_t to_cpu);
+    uint64_t next_tick(const CPURunQueue* runqueue) const;
+
+    void kick_idle_cpu(const CPURunQueue* busy);
+
+    void update_min_vruntime(CPURunQueue* runqueue);
+
+    static uint32_t weight(const Process* process);
+
+    void enqueue(CPURunQueue* runqueue, Process* process);
+
+    void dequeue(CPURunQueue* runqueue, Process* process);
+
+    size_t nr_running(const CPURunQueue* runqueue) const;
+
+    CPURunQueue* lock_task_runqueue(Process* process, uint64_t& flags);
+
+    uint64_t runnable_weight(const CPURunQueue* runqueue) const;
+
+    bool can_migrate_process(const Process* process, const CPURunQueue* to_runqueue) const;
+
+    Process* find_migratable(CPURunQueue* from_runqueue, CPURunQueue* to_runqueue,
+                             uint64_t max_weight);
+
+    void migrate_process(Process* process, CPURunQueue* from_runqueue, CPURunQueue* to_runqueue);
 
     Vector<CPURunQueue> m_runqueues;
 
     SchedulerPolicy m_policy = SchedulerPolicy::RoundRobin;
 
+    static constexpr uint8_t MAX_PRIORITY = CPURunQueue::PRIORITY_LEVELS - 1;
     static constexpr uint64_t DEFAULT_TIME_SLICE = 5;
     static constexpr uint64_t LOAD_BALANCE_PERIOD = 100;
-
-    uint64_t m_load_balance_counter = 0;
+    static constexpr uint64_t LOAD_DECAY = 8;
+    static constexpr uint64_t IMBALANCE_PERCENT = 125;
+
+    static constexpr uint32_t NICE_0_WEIGHT = 1024;
+    static constexpr uint64_t VRUNTIME_SCALE = 1024;
+    static constexpr uint64_t TARGET_LATENCY = 6;
+    static constexpr uint64_t MIN_GRANULARITY = 1;
+    static constexpr uint64_t WAKEUP_GRANULARITY = VRUNTIME_SCALE;
+    static constexpr uint64_t SLEEPER_CREDIT = TARGET_LATENCY * VRUNTIME_SCALE / 2;
 };
 
 }  // namespace kernel
\ No newline at end of file
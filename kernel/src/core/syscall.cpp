@@ -3,6 +3,7 @@
 #include <cstring>
 
 #include "ipc.hpp"
+#include "memory/virtual_memory.hpp"
 #include "printf.hpp"
 #include "process.hpp"
 #include "scheduler.hpp"
@@ -32,6 +33,9 @@ int64_t SyscallHandler::handle(SyscallContext& ctx) {
         case SyscallNumber::Munmap:
             return sys_munmap(reinterpret_cast<void*>(ctx.rdi), ctx.rsi);
 
+        case SyscallNumber::Mprotect:
+            return sys_mprotect(reinterpret_cast<void*>(ctx.rdi), ctx.rsi, ctx.rdx);
+
         case SyscallNumber::Brk:
             return sys_brk(reinterpret_cast<void*>(ctx.rdi));
 
@@ -88,7 +92,7 @@ int64_t SyscallHandler::handle(SyscallContext& ctx) {
     }
 }
 
-int64_t SyscallHandler::sys_read(int fd, void* buf, size_t count) {
+int64_t SyscallHandler::sys_read(int, void*, size_t) {
     return -1;
 }
 
@@ -103,21 +107,44 @@ int64_t SyscallHandler::sys_write(int fd, const void* buf, size_t count) {
     return -1;
 }
 
-int64_t SyscallHandler::sys_open(const char* pathname, int flags, mode_t mode) {
+int64_t SyscallHandler::sys_open(const char*, int, mode_t) {
     return -1;
 }
 
-int64_t SyscallHandler::sys_close(int fd) {
+int64_t SyscallHandler::sys_close(int) {
     return -1;
 }
 
-void* SyscallHandler::sys_mmap(void* addr, size_t length, int prot, int flags, int fd,
-                               off_t offset) {
-    return nullptr;
+void* SyscallHandler::sys_mmap(void* addr, size_t length, int prot, int flags, int, off_t) {
+    auto& pm = ProcessManager::instance();
+    auto* process = pm.get_current_process();
+    if (!process) return nullptr;
+
+    if (!(flags & MAP_ANONYMOUS)) return nullptr;
+
+    uint64_t address = pm.map_anonymous(process, reinterpret_cast<uint64_t>(addr), length,
+                                        (prot & PROT_WRITE) != 0, (prot & PROT_EXEC) != 0,
+                                        (flags & MAP_FIXED) != 0);
+    return address ? reinterpret_cast<void*>(address) : nullptr;
 }
 
 int64_t SyscallHandler::sys_munmap(void* addr, size_t length) {
-    return -1;
+    auto& pm = ProcessManager::instance();
+    auto* process = pm.get_current_process();
+    if (!process) return -1;
+
+    return pm.unmap_memory(process, reinterpret_cast<uint64_t>(addr), length) ? 0 : -1;
+}
+
+int64_t SyscallHandler::sys_mprotect(void* addr, size_t length, int prot) {
+    auto& pm = ProcessManager::instance();
+    auto* process = pm.get_current_process();
+    if (!process) return -1;
+
+    return pm.protect_memory(process, reinterpret_cast<uint64_t>(addr), length,
+                             (prot & PROT_WRITE) != 0, (prot & PROT_EXEC) != 0)
+               ? 0
+               : -1;
 }
 
 int64_t SyscallHandler::sys_brk(void* addr) {
@@ -128,13 +155,12 @@ int64_t SyscallHandler::sys_brk(void* addr) {
     if (addr == nullptr) return process->brk;
 
     uint64_t new_brk = reinterpret_cast<uint64_t>(addr);
-    if (new_brk < process->program_break) return -1;
+    if (!pm.set_break(process, new_brk)) return -1;
 
-    process->brk = new_brk;
     return new_brk;
 }
 
-void SyscallHandler::sys_exit(int status) {
+void SyscallHandler::sys_exit(int) {
     auto& pm = ProcessManager::instance();
     auto* process = pm.get_current_process();
     if (process) {
@@ -152,30 +178,11 @@ pid_t SyscallHandler::sys_fork() {
     auto* child = pm.get_process(child_pid);
     if (!child) return -1;
 
-    auto& vmm = VirtualMemoryManager::instance();
-    auto& pmm = PhysicalMemoryManager::instance();
-
-    MemoryRegion* region = parent->memory_regions;
-    while (region) {
-        for (uint64_t addr = region->start; addr < region->start + region->size; addr += 4096) {
-            uintptr_t new_phys = reinterpret_cast<uintptr_t>(pmm.allocate_frame());
-            if (!new_phys) {
-                pm.terminate_process(child_pid);
-                return -1;
-            }
-
-            vmm.map_page(addr, new_phys, region->writable);
-
-            uintptr_t parent_phys = vmm.get_physical_address(addr);
-            memcpy(reinterpret_cast<void*>(new_phys), reinterpret_cast<void*>(parent_phys), 4096);
-        }
-
-        add_memory_region(child, region->start, region->size, region->writable, region->executable);
-        region = region->next;
+    if (!pm.clone_memory(parent, child)) {
+        pm.terminate_process(child_pid);
+        return -1;
     }
 
-    child->brk = parent->brk;
-    child->program_break = parent->program_break;
     child->entry_point = parent->entry_point;
     child->registers = parent->registers;
 
@@ -210,25 +217,29 @@ int64_t SyscallHandler::sys_execve(const char* filename, char* const argv[], cha
     auto* process = pm.get_current_process();
     if (!process) return -1;
 
-    auto old_regions = process->memory_regions;
-    process->memory_regions = nullptr;
+    auto* old_space = process->address_space;
+    RegionTree old_regions;
+    old_regions.swap(process->regions);
+    uint64_t old_resident = process->resident_pages;
+    process->address_space = nullptr;
+    process->resident_pages = 0;
 
     if (!pm.load_program(process, filename)) {
-        process->memory_regions = old_regions;
+        pm.release_memory(process->address_space, process->regions);
+        process->address_space = old_space;
+        process->regions.swap(old_regions);
+        process->resident_pages = old_resident;
         return -1;
     }
 
-    while (old_regions) {
-        auto* next = old_regions->next;
-        delete old_regions;
-        old_regions = next;
-    }
+    pm.release_memory(old_space, old_regions);
 
     if (!pm.setup_process_stack(process, argv, envp)) {
         pm.terminate_process(process->pid);
         return -1;
     }
 
+    VirtualMemoryManager::instance().activate(process->address_space);
     pm.switch_to_process(process);
 
     return 0;
@@ -66,6 +66,7 @@ private:
 
     static void* sys_mmap(void* addr, size_t length, int prot, int flags, int fd, off_t offset);
     static int64_t sys_munmap(void* addr, size_t length);
+    static int64_t sys_mprotect(void* addr, size_t length, int prot);
     static int64_t sys_brk(void* addr);
 
     static off_t sys_lseek(int fd, off_t offset, int whence);
@@ -0,0 +1,79 @@
+#include "vma.hpp"
+
+#include "memory/slab.hpp"
+
+namespace kernel {
+
+namespace {
+SlabCache* memory_region_cache() {
+    static SlabCache* cache = SlabAllocator::instance().create_cache(
+        "memory_region", sizeof(MemoryRegion), alignof(MemoryRegion));
+    return cache;
+}
+}  // namespace
+
+void* MemoryRegion::operator new(size_t) {
+    return memory_region_cache()->allocate();
+}
+
+void MemoryRegion::operator delete(void* ptr) {
+    memory_region_cache()->free(ptr);
+}
+
+MemoryRegion* RegionTree::find(uint64_t address) const {
+    auto* node = static_cast<MemoryRegion*>(m_tree.root());
+    while (node) {
+        if (address < node->start)
+            node = static_cast<MemoryRegion*>(node->left);
+        else if (address >= node->end())
+            node = static_cast<MemoryRegion*>(node->right);
+        else
+            return node;
+    }
+    return nullptr;
+}
+
+MemoryRegion* RegionTree::lower_bound(uint64_t address) const {
+    MemoryRegion* result = nullptr;
+    auto* node = static_cast<MemoryRegion*>(m_tree.root());
+    while (node) {
+        if (node->end() > address) {
+            result = node;
+            node = static_cast<MemoryRegion*>(node->left);
+        } else
+            node = static_cast<MemoryRegion*>(node->right);
+    }
+    return result;
+}
+
+void RegionTree::insert(MemoryRegion* region) {
+    m_tree.insert(region, [](const AVLNode* a, const AVLNode* b) {
+        return static_cast<const MemoryRegion*>(a)->start <
+               static_cast<const MemoryRegion*>(b)->start;
+    });
+}
+
+void RegionTree::clear() {
+    AVLNode* node = m_tree.root();
+    while (node) {
+        if (node->left) {
+            node = node->left;
+        } else if (node->right) {
+            node = node->right;
+        } else {
+            AVLNode* parent = node->parent;
+            if (parent) {
+                if (parent->left == node)
+                    parent->left = nullptr;
+                else
+                    parent->right = nullptr;
+            }
+            delete static_cast<MemoryRegion*>(node);
+            node = parent;
+        }
+    }
+
+    m_tree.reset();
+}
+
+}  // namespace kernel
\ No newline at end of file
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "lib/avl_tree.hpp"
+
+namespace kernel {
+
+enum class RegionKind : uint8_t {
+    Image,
+    Heap,
+    Stack,
+    Anonymous,
+};
+
+struct MemoryRegion : AVLNode {
+    uint64_t start = 0;
+    uint64_t size = 0;
+    bool writable = false;
+    bool executable = false;
+    RegionKind kind = RegionKind::Anonymous;
+
+    uint64_t end() const {
+        return start + size;
+    }
+    bool compatible(const MemoryRegion& other) const {
+        return kind == other.kind && writable == other.writable &&
+               executable == other.executable;
+    }
+
+    static void* operator new(size_t size);
+    static void operator delete(void* ptr);
+};
+
+class RegionTree {
+public:
+    RegionTree() = default;
+    ~RegionTree() {
+        clear();
+    }
+
+    RegionTree(const RegionTree&) = delete;
+    RegionTree& operator=(const RegionTree&) = delete;
+
+    MemoryRegion* find(uint64_t address) const;
+    MemoryRegion* lower_bound(uint64_t address) const;
+    MemoryRegion* first() const {
+        return static_cast<MemoryRegion*>(m_tree.first());
+    }
+    static MemoryRegion* next(const MemoryRegion* region) {
+        return static_cast<MemoryRegion*>(AVLTree::next(region));
+    }
+    static MemoryRegion* prev(const MemoryRegion* region) {
+        return static_cast<MemoryRegion*>(AVLTree::prev(region));
+    }
+
+    void insert(MemoryRegion* region);
+    void remove(MemoryRegion* region) {
+        m_tree.remove(region);
+    }
+    void clear();
+    void swap(RegionTree& other) {
+        m_tree.swap(other.m_tree);
+    }
+
+    size_t count() const {
+        return m_tree.count();
+    }
+
+private:
+    AVLTree m_tree;
+};
+
+}  // namespace kernel
\ No newline at end of file
@@ -0,0 +1,39 @@
+#include "serial.hpp"
+
+#include "io.hpp"
+
+namespace {
+bool serial_ready = false;
+
+bool transmit_empty() {
+    return inb(SERIAL_COM1_PORT + 5) & 0x20;
+}
+}  // namespace
+
+void init_serial() {
+    outb(SERIAL_COM1_PORT + 1, 0x00);
+    outb(SERIAL_COM1_PORT + 3, 0x80);
+    outb(SERIAL_COM1_PORT + 0, 0x01);
+    outb(SERIAL_COM1_PORT + 1, 0x00);
+    outb(SERIAL_COM1_PORT + 3, 0x03);
+    outb(SERIAL_COM1_PORT + 2, 0xC7);
+    outb(SERIAL_COM1_PORT + 4, 0x0B);
+
+    serial_ready = inb(SERIAL_COM1_PORT + 5) != 0xFF;
+}
+
+void serial_putchar(char c) {
+    if (!serial_ready) return;
+
+    if (c == '\n') serial_putchar('\r');
+
+    while (!transmit_empty())
+        asm volatile("pause");
+
+    outb(SERIAL_COM1_PORT, c);
+}
+
+void serial_write(const char* str) {
+    while (*str)
+        serial_putchar(*str++);
+}
\ No newline at end of file
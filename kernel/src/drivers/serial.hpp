@@ -0,0 +1,8 @@
+#pragma once
+#include <cstdint>
+
+constexpr uint16_t SERIAL_COM1_PORT = 0x3F8;
+
+void init_serial();
+void serial_putchar(char c);
+void serial_write(const char* str);
\ No newline at end of file
@@ -19,8 +19,8 @@ ACPIRSDP* find_rsdp(uintptr_t start, uintptr_t end) {
     const char signature[] = "RSD PTR ";
 
     for (uintptr_t addr = start; addr < end; addr += 16) {
-        if (memcmp((void*)addr, signature, 8) == 0) {
-            ACPIRSDP* rsdp = (ACPIRSDP*)addr;
+        if (memcmp(phys_to_virt(addr), signature, 8) == 0) {
+            ACPIRSDP* rsdp = phys_to_virt<ACPIRSDP>(addr);
 
             uint8_t sum = 0;
             for (size_t i = 0; i < 20; i++) {
@@ -55,15 +55,16 @@ bool verify_table_checksum(ACPISDTHeader* table) {
 
 void* map_and_verify_table(uintptr_t phys_addr) {
     auto& vmm = VirtualMemoryManager::instance();
-    uintptr_t virt_addr = phys_addr + 0xFFFF800000000000;
+    uintptr_t page = phys_addr & ~(VirtualMemoryManager::PAGE_SIZE - 1);
+    auto map_span = [&](size_t length) {
+        return vmm.map_range(reinterpret_cast<uintptr_t>(phys_to_virt(page)), page,
+                             phys_addr + length - page);
+    };
 
-    vmm.map_page(virt_addr, phys_addr, true);
+    if (!map_span(sizeof(ACPISDTHeader))) return nullptr;
 
-    ACPISDTHeader* header = (ACPISDTHeader*)virt_addr;
-
-    for (uintptr_t offset = 4096; offset < header->length; offset += 4096) {
-        vmm.map_page(virt_addr + offset, phys_addr + offset, true);
-    }
+    auto* header = phys_to_virt<ACPISDTHeader>(phys_addr);
+    if (!map_span(header->length)) return nullptr;
 
     if (!verify_table_checksum(header)) {
         printf("ACPI table checksum failed: %.4s\n", header->signature);
@@ -83,7 +84,7 @@ bool init_acpi() {
     uint16_t ebda_segment = 0;
 
     if (BDA_EBDA_PTR < 0x1000) {
-        asm volatile("movw (%1), %0" : "=r"(ebda_segment) : "r"(BDA_EBDA_PTR));
+        asm volatile("movw (%1), %0" : "=r"(ebda_segment) : "r"(phys_to_virt(BDA_EBDA_PTR)));
 
         if (ebda_segment > 0 && ebda_segment < 0xA000)
             ebda_addr = static_cast<uintptr_t>(ebda_segment) << 4;
@@ -101,7 +102,7 @@ bool init_acpi() {
         return false;
     }
 
-    printf("ACPI RSDP found at 0x%lx, revision %d\n", (uintptr_t)g_rsdp, g_rsdp->revision);
+    printf("ACPI RSDP found at 0x%lx, revision %d\n", virt_to_phys(g_rsdp), g_rsdp->revision);
 
     if (g_rsdp->revision >= 2 && g_rsdp->xsdt_address) {
         g_xsdt = (ACPIXSDT*)map_and_verify_table(g_rsdp->xsdt_address);
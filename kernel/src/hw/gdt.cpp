@@ -1,5 +1,7 @@
 #include "gdt.hpp"
 
+#include "vga.hpp"
+
 extern "C" {
 uint32_t read_cr4();
 void write_cr4(uint32_t value);
@@ -39,10 +41,22 @@ void create_descriptor(GDTEntry& entry, uint32_t base, uint32_t limit, uint8_t a
 }
 
 extern "C" void load_gdt(GDTDescriptor* gdtr);
+
+void enable_sse() {
+    uint32_t cr0 = read_cr0();
+    cr0 &= ~(1 << 2);
+    cr0 |= (1 << 1);
+    write_cr0(cr0);
+
+    uint32_t cr4 = read_cr4();
+    cr4 |= (1 << 9);
+    cr4 |= (1 << 10);
+    write_cr4(cr4);
+}
 }  // namespace
 
 void init_gdt() {
-    volatile uint16_t* vga = reinterpret_cast<uint16_t*>(0xB8000);
+    volatile uint16_t* vga = vga_memory();
     vga[40] = 0x0400 | '1';
 
     create_descriptor(gdt.null, 0, 0, 0, 0);
@@ -73,15 +87,12 @@ void init_gdt() {
     load_gdt(&gdtr);
     vga[48] = 0x0400 | '9';
 
-    uint32_t cr0 = read_cr0();
-    cr0 &= ~(1 << 2);
-    cr0 |= (1 << 1);
-    write_cr0(cr0);
-
-    uint32_t cr4 = read_cr4();
-    cr4 |= (1 << 9);
-    cr4 |= (1 << 10);
-    write_cr4(cr4);
+    enable_sse();
 
     vga[49] = 0x0400 | 'A';
+}
+
+void load_gdt_on_ap() {
+    load_gdt(&gdtr);
+    enable_sse();
 }
\ No newline at end of file
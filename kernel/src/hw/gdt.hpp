@@ -24,4 +24,5 @@ struct GDT {
     GDTEntry user_data;
 } __attribute__((packed));
 
-void init_gdt();
\ No newline at end of file
+void init_gdt();
+void load_gdt_on_ap();
\ No newline at end of file
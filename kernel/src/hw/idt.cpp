@@ -2,6 +2,9 @@
 
 #include <cstring>
 
+#include "core/process.hpp"
+#include "core/syscall.hpp"
+#include "hw/smp.hpp"
 #include "io.hpp"
 #include "keyboard.hpp"
 #include "pic.hpp"
@@ -12,6 +15,7 @@
 namespace {
 
 constexpr size_t IDT_ENTRIES = 256;
+constexpr uint64_t PAGE_FAULT_VECTOR = 14;
 IDTEntry idt[IDT_ENTRIES] = {};
 IDTDescriptor idtr = {sizeof(idt) - 1, 0};
 
@@ -113,6 +117,10 @@ extern "C" void isr45();
 extern "C" void isr46();
 extern "C" void isr47();
 
+extern "C" void isr64();
+extern "C" void isr65();
+extern "C" void isr128();
+
 }  // namespace
 
 struct InterruptFrame {
@@ -124,8 +132,17 @@ struct InterruptFrame {
 
 extern "C" void isr_handler(InterruptFrame* frame) {
     if (frame->interrupt_number < 32) {
+        uint64_t fault_address = 0;
+        if (frame->interrupt_number == PAGE_FAULT_VECTOR) {
+            asm volatile("mov %%cr2, %0" : "=r"(fault_address));
+            if (kernel::ProcessManager::instance().handle_page_fault(fault_address,
+                                                                     frame->error_code))
+                return;
+        }
+
         printf("Exception: %s\n", exception_messages[frame->interrupt_number]);
         printf("Error Code: %lu\n", frame->error_code);
+        if (frame->interrupt_number == PAGE_FAULT_VECTOR) printf("CR2: 0x%lx\n", fault_address);
         printf("RIP: 0x%lx\n", frame->rip);
         printf("CS: 0x%lx\n", frame->cs);
         printf("RFLAGS: 0x%lx\n", frame->rflags);
@@ -144,6 +161,14 @@ extern "C" void isr_handler(InterruptFrame* frame) {
             // assembly
         } else if (irq == 1)
             keyboard_handler();
+    } else if (frame->interrupt_number == kernel::IPI_VECTOR)
+        kernel::SMPManager::instance().handle_ipi();
+    else if (frame->interrupt_number == kernel::TIMER_VECTOR)
+        kernel::SMPManager::instance().handle_timer();
+    else if (frame->interrupt_number == SYSCALL_VECTOR) {
+        kernel::SyscallContext context = {frame->rax, frame->rdi, frame->rsi, frame->rdx,
+                                          frame->r10, frame->r8,  frame->r9};
+        frame->rax = kernel::SyscallHandler::handle(context);
     }
 }
 
@@ -306,10 +331,18 @@ void init_idt() {
         set_interrupt_handler(32 + irq, handler, IDT_PRESENT | IDT_DPL0 | IDT_INTERRUPT_GATE);
     }
 
+    set_interrupt_handler(kernel::IPI_VECTOR, isr64, IDT_PRESENT | IDT_DPL0 | IDT_INTERRUPT_GATE);
+    set_interrupt_handler(kernel::TIMER_VECTOR, isr65, IDT_PRESENT | IDT_DPL0 | IDT_INTERRUPT_GATE);
+    set_interrupt_handler(SYSCALL_VECTOR, isr128, IDT_PRESENT | IDT_DPL3 | IDT_INTERRUPT_GATE);
+
     idtr.offset = reinterpret_cast<uint64_t>(&idt);
     load_idt(&idtr);
 }
 
+void load_idt_on_ap() {
+    load_idt(&idtr);
+}
+
 void set_interrupt_handler(uint8_t vector, void (*handler)(), uint8_t flags) {
     if (handler) create_descriptor(idt[vector], handler, 0x08, flags);
 }
\ No newline at end of file
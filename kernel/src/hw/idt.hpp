@@ -22,6 +22,8 @@ constexpr uint8_t IDT_DPL0 = 0x00;
 constexpr uint8_t IDT_DPL3 = 0x60;
 constexpr uint8_t IDT_INTERRUPT_GATE = 0x0E;
 constexpr uint8_t IDT_TRAP_GATE = 0x0F;
+constexpr uint8_t SYSCALL_VECTOR = 0x80;
 
 void init_idt();
+void load_idt_on_ap();
 void set_interrupt_handler(uint8_t vector, void (*handler)(), uint8_t flags);
\ No newline at end of file
@@ -3,11 +3,17 @@
 #include <cstring>
 
 #include "acpi.hpp"
+#include "core/scheduler.hpp"
+#include "gdt.hpp"
+#include "idt.hpp"
 #include "io.hpp"
+#include "lib/spinlock.hpp"
 #include "memory/heap.hpp"
 #include "memory/physical_memory.hpp"
+#include "memory/tlb.hpp"
 #include "memory/virtual_memory.hpp"
 #include "printf.hpp"
+#include "timer.hpp"
 
 namespace kernel {
 
@@ -37,21 +43,38 @@ constexpr uint32_t LAPIC_TIMER_INIT = 0x380;
 constexpr uint32_t LAPIC_TIMER_CUR = 0x390;
 constexpr uint32_t LAPIC_TIMER_DIV = 0x3E0;
 
+constexpr uint32_t LAPIC_TIMER_MASKED = 1 << 16;
+constexpr uint32_t LAPIC_TIMER_TSC_DEADLINE = 2 << 17;
+constexpr uint32_t LAPIC_TIMER_DIVIDE_16 = 0x3;
+
+constexpr uint8_t PIT_GATE_ENABLE = 1 << 0;
+constexpr uint8_t PIT_SPEAKER_ENABLE = 1 << 1;
+constexpr uint8_t PIT_GATE_OUTPUT = 1 << 5;
+constexpr uint32_t CALIBRATION_HZ = 100;
+
 constexpr uint64_t CPU_STACK_SIZE = 16 * 1024;
 constexpr uint64_t CPU_TRAMPOLINE_ADDR = 0x8000;
 constexpr uint32_t AP_STARTUP_VECTOR = 0x08;
+constexpr uint64_t AP_STARTUP_TIMEOUT_MS = 1000;
+constexpr uint64_t AP_STARTUP_FALLBACK_CYCLES = 1ULL << 32;
 
 constexpr uint32_t CPUID_FEAT_EDX_APIC = 1 << 9;
+constexpr uint32_t CPUID_EXT_FEAT_EDX_RDTSCP = 1 << 27;
+constexpr uint32_t CPUID_FEAT_ECX_TSC_DEADLINE = 1 << 24;
 
 extern "C" volatile uint32_t g_ap_ready_count;
 extern "C" volatile uint32_t g_ap_lock;
 extern "C" volatile uint32_t g_ap_target_cpu;
+extern "C" volatile uint64_t g_ap_cr3;
+extern "C" volatile uint64_t g_ap_stack;
 extern "C" void* g_ap_trampoline_start;
 extern "C" void* g_ap_trampoline_end;
 
 namespace {
 
 constexpr uint32_t MSR_APIC_BASE = 0x1B;
+constexpr uint32_t MSR_TSC_AUX = 0xC0000103;
+constexpr uint32_t MSR_TSC_DEADLINE = 0x6E0;
 constexpr uint64_t MSR_APIC_ENABLE = (1 << 11);
 constexpr uint64_t MSR_BSP_FLAG = (1 << 8);
 
@@ -63,6 +86,27 @@ bool check_apic_available() {
     return (edx & CPUID_FEAT_EDX_APIC) != 0;
 }
 
+bool check_rdtscp_available() {
+    uint32_t eax, ebx, ecx, edx;
+    asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0x80000000));
+    if (eax < 0x80000001) return false;
+
+    asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0x80000001));
+    return (edx & CPUID_EXT_FEAT_EDX_RDTSCP) != 0;
+}
+
+bool check_tsc_deadline_available() {
+    uint32_t eax, ebx, ecx, edx;
+    asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+    return (ecx & CPUID_FEAT_ECX_TSC_DEADLINE) != 0;
+}
+
+uint32_t read_initial_apic_id() {
+    uint32_t eax, ebx, ecx, edx;
+    asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+    return ebx >> 24;
+}
+
 uint64_t read_msr(uint32_t msr) {
     uint32_t low, high;
     asm volatile("rdmsr" : "=a"(low), "=d"(high) : "c"(msr));
@@ -79,12 +123,25 @@ void lapic_write(void* base, uint32_t reg, uint32_t value) {
     *((volatile uint32_t*)((uint8_t*)base + reg)) = value;
 }
 
+uint32_t lapic_read(void* base, uint32_t reg) {
+    return *((volatile uint32_t*)((uint8_t*)base + reg));
+}
+
 void delay(uint32_t count) {
     for (uint32_t i = 0; i < count; i++) {
         asm volatile("pause");
     }
 }
 
+void wait_until_active(const CPUInfo& cpu, uint64_t timeout_cycles) {
+    uint64_t start = read_tsc();
+    while (!__atomic_load_n(&cpu.is_active, __ATOMIC_ACQUIRE) &&
+           read_tsc() - start < timeout_cycles)
+        asm volatile("pause");
+}
+
+Spinlock calibration_lock;
+
 extern "C" void ap_trampoline();
 extern "C" void ap_start();
 
@@ -98,15 +155,29 @@ extern "C" void ap_main(uint32_t cpu_id) {
             asm volatile("hlt");
     }
 
-    cpu_info->is_active = true;
+    smp.init_cpu_local(cpu_id);
+    load_gdt_on_ap();
+    VirtualMemoryManager::instance().initialize_cpu();
+
+    smp.setup_local_apic();
+    smp.start_local_timer(cpu_id);
+    load_idt_on_ap();
+
+    __atomic_store_n(&cpu_info->is_active, true, __ATOMIC_RELEASE);
     __atomic_add_fetch(&g_ap_ready_count, 1, __ATOMIC_SEQ_CST);
 
     printf("AP CPU %u (LAPIC ID: %u) is now active\n", cpu_id, cpu_info->lapic_id);
 
-    asm volatile("sti");
-
+    auto& scheduler = Scheduler::instance();
     for (;;) {
-        asm volatile("hlt");
+        smp.process_cpu_work(cpu_id);
+        scheduler.schedule_on_cpu(cpu_id);
+
+        asm volatile("cli");
+        if (smp.has_cpu_work(cpu_id))
+            asm volatile("sti");
+        else
+            asm volatile("sti; hlt");
     }
 }
 
@@ -136,6 +207,17 @@ void SMPManager::initialize() {
 
     init_io_apic();
 
+    init_cpu_local(get_current_cpu_id());
+    m_rdtscp = check_rdtscp_available();
+    m_tsc_deadline = check_tsc_deadline_available();
+
+    uint32_t bsp_id = get_current_cpu_id();
+    start_local_timer(bsp_id);
+
+    CPUInfo* bsp_info = get_cpu_info(bsp_id);
+    if (bsp_info && bsp_info->timer_mode != TimerMode::None)
+        use_local_timers(bsp_info->tsc_per_tick);
+
     m_smp_enabled = true;
 
     printf("SMP initialized with %u CPUs\n", m_cpu_count);
@@ -173,27 +255,19 @@ void SMPManager::detect_cpus() {
                 cpu.id = cpu_count++;
                 cpu.lapic_id = proc_lapic->apic_id;
                 cpu.is_bsp = (read_msr(MSR_APIC_BASE) & MSR_BSP_FLAG) != 0 &&
-                             cpu.lapic_id == (read_msr(MSR_APIC_BASE) >> 24);
+                             cpu.lapic_id == read_initial_apic_id();
                 cpu.is_active = cpu.is_bsp;
                 cpu.local_apic_base = (void*)(uintptr_t)madt->local_apic_addr;
 
                 auto& pmm = PhysicalMemoryManager::instance();
-                auto& vmm = VirtualMemoryManager::instance();
-
-                uint64_t stack_start_addr = 0;
-                for (uint64_t i = 0; i < CPU_STACK_SIZE; i += 4096) {
-                    void* frame_ptr = pmm.allocate_frame();
-                    uint64_t frame = frame_ptr ? reinterpret_cast<uintptr_t>(frame_ptr) : 0;
 
-                    if (i == 0) stack_start_addr = frame;
-                }
+                uint64_t stack_start_addr = reinterpret_cast<uintptr_t>(
+                    pmm.allocate_contiguous(CPU_STACK_SIZE / 4096, CPU_STACK_SIZE));
 
                 if (stack_start_addr) {
-                    uint64_t stack_virt = stack_start_addr + 0xFFFF800000000000;
-                    for (uint64_t i = 0; i < CPU_STACK_SIZE; i += 4096) {
-                        vmm.map_page(stack_virt + i, stack_start_addr + i, true);
-                    }
-                    cpu.kernel_stack = stack_virt + CPU_STACK_SIZE;
+                    cpu.kernel_stack =
+                        reinterpret_cast<uint64_t>(phys_to_virt(stack_start_addr)) +
+                        CPU_STACK_SIZE;
                 }
 
                 m_cpus.push_back(cpu);
@@ -223,17 +297,26 @@ void SMPManager::detect_cpus() {
 void SMPManager::init_local_apic() {
     uint64_t apic_base = read_msr(MSR_APIC_BASE);
 
-    write_msr(MSR_APIC_BASE, apic_base | MSR_APIC_ENABLE);
-
     auto& vmm = VirtualMemoryManager::instance();
     uint64_t apic_phys = apic_base & 0xFFFFF000;
-    uint64_t apic_virt = apic_phys + 0xFFFF800000000000;
-    vmm.map_page(apic_virt, apic_phys, true);
+    uint64_t apic_virt = apic_phys + VirtualMemoryManager::PHYSMAP_BASE;
+    vmm.map_range(apic_virt, apic_phys, VirtualMemoryManager::PAGE_SIZE,
+                  MAP_WRITABLE | MAP_NO_CACHE);
+
+    m_lapic_base = (void*)apic_virt;
+
+    setup_local_apic();
+
+    printf("Local APIC initialized for CPU %u\n", get_current_cpu_id());
+}
+
+void SMPManager::setup_local_apic() {
+    write_msr(MSR_APIC_BASE, read_msr(MSR_APIC_BASE) | MSR_APIC_ENABLE);
 
     CPUInfo* cpu_info = get_current_cpu_info();
-    if (cpu_info) cpu_info->local_apic_base = (void*)apic_virt;
+    if (cpu_info) cpu_info->local_apic_base = m_lapic_base;
 
-    void* lapic_base = (void*)apic_virt;
+    void* lapic_base = m_lapic_base;
 
     lapic_write(lapic_base, LAPIC_SVR, 0x1FF);
 
@@ -246,10 +329,72 @@ void SMPManager::init_local_apic() {
 
     lapic_write(lapic_base, LAPIC_LINT1, 0x400);
 
-    lapic_write(lapic_base, LAPIC_TIMER_DIV, 0x3);
-    lapic_write(lapic_base, LAPIC_TIMER, 0x10000);
+    lapic_write(lapic_base, LAPIC_TIMER_DIV, LAPIC_TIMER_DIVIDE_16);
+    lapic_write(lapic_base, LAPIC_TIMER, LAPIC_TIMER_MASKED);
+}
+
+bool SMPManager::calibrate_timer(CPUInfo* cpu_info, uint32_t frequency) {
+    ScopedLock guard(calibration_lock);
 
-    printf("Local APIC initialized for CPU %u\n", get_current_cpu_id());
+    uint16_t divisor = PIT_FREQUENCY / CALIBRATION_HZ;
+    uint8_t gate = inb(PIT_GATE) & ~(PIT_GATE_ENABLE | PIT_SPEAKER_ENABLE);
+
+    outb(PIT_GATE, gate);
+    outb(PIT_COMMAND, 0xB0);
+    outb(PIT_CHANNEL2, divisor & 0xFF);
+    outb(PIT_CHANNEL2, (divisor >> 8) & 0xFF);
+
+    lapic_write(m_lapic_base, LAPIC_TIMER_DIV, LAPIC_TIMER_DIVIDE_16);
+    lapic_write(m_lapic_base, LAPIC_TIMER, LAPIC_TIMER_MASKED);
+
+    outb(PIT_GATE, gate | PIT_GATE_ENABLE);
+    lapic_write(m_lapic_base, LAPIC_TIMER_INIT, 0xFFFFFFFF);
+    uint64_t tsc_start = read_tsc();
+
+    while (!(inb(PIT_GATE) & PIT_GATE_OUTPUT))
+        asm volatile("pause");
+
+    uint64_t tsc_elapsed = read_tsc() - tsc_start;
+    uint32_t elapsed = 0xFFFFFFFF - lapic_read(m_lapic_base, LAPIC_TIMER_CUR);
+    lapic_write(m_lapic_base, LAPIC_TIMER_INIT, 0);
+    outb(PIT_GATE, gate);
+
+    cpu_info->timer_count = static_cast<uint64_t>(elapsed) * CALIBRATION_HZ / frequency;
+    cpu_info->tsc_per_tick = tsc_elapsed * CALIBRATION_HZ / frequency;
+    return cpu_info->timer_count && cpu_info->tsc_per_tick;
+}
+
+void SMPManager::start_local_timer(uint32_t cpu_id) {
+    CPUInfo* cpu_info = get_cpu_info(cpu_id);
+    uint32_t frequency = get_timer_frequency();
+    if (!cpu_info || !m_lapic_base || !frequency) return;
+
+    if (!calibrate_timer(cpu_info, frequency)) return;
+
+    if (m_tsc_deadline) {
+        cpu_info->timer_mode = TimerMode::TscDeadline;
+        lapic_write(m_lapic_base, LAPIC_TIMER, TIMER_VECTOR | LAPIC_TIMER_TSC_DEADLINE);
+    } else {
+        cpu_info->timer_mode = TimerMode::OneShot;
+        lapic_write(m_lapic_base, LAPIC_TIMER, TIMER_VECTOR);
+    }
+
+    set_next_tick(1);
+}
+
+void SMPManager::set_next_tick(uint64_t ticks) {
+    CPUInfo* cpu_info = get_current_cpu_info();
+    if (!cpu_info || !m_lapic_base || cpu_info->timer_mode == TimerMode::None) return;
+
+    if (ticks && cpu_info->tick_stopped) cpu_info->last_tick = get_ticks();
+    cpu_info->tick_stopped = !ticks;
+
+    if (cpu_info->timer_mode == TimerMode::TscDeadline) {
+        write_msr(MSR_TSC_DEADLINE, ticks ? read_tsc() + ticks * cpu_info->tsc_per_tick : 0);
+    } else {
+        uint64_t count = ticks * cpu_info->timer_count;
+        lapic_write(m_lapic_base, LAPIC_TIMER_INIT, count > 0xFFFFFFFF ? 0xFFFFFFFF : count);
+    }
 }
 
 void SMPManager::init_io_apic() {
@@ -270,8 +415,9 @@ void SMPManager::init_io_apic() {
 
             auto& vmm = VirtualMemoryManager::instance();
             uint64_t ioapic_phys = io_apic->address;
-            uint64_t ioapic_virt = ioapic_phys + 0xFFFF800000000000;
-            vmm.map_page(ioapic_virt, ioapic_phys, true);
+            uint64_t ioapic_virt = ioapic_phys + VirtualMemoryManager::PHYSMAP_BASE;
+            vmm.map_range(ioapic_virt, ioapic_phys, VirtualMemoryManager::PAGE_SIZE,
+                          MAP_WRITABLE | MAP_NO_CACHE);
 
             printf("I/O APIC found at address 0x%x, ID %u, GSI base %u\n", io_apic->address,
                    io_apic->id, io_apic->global_int_base);
@@ -292,10 +438,10 @@ void SMPManager::startup_application_processors() {
 
     auto& vmm = VirtualMemoryManager::instance();
 
-    vmm.map_page(CPU_TRAMPOLINE_ADDR, CPU_TRAMPOLINE_ADDR, true);
+    g_ap_cr3 = virt_to_phys(vmm.get_kernel_address_space()->pml4);
 
     size_t trampoline_size = (size_t)&g_ap_trampoline_end - (size_t)&g_ap_trampoline_start;
-    memcpy((void*)CPU_TRAMPOLINE_ADDR, &g_ap_trampoline_start, trampoline_size);
+    memcpy(phys_to_virt(CPU_TRAMPOLINE_ADDR), &g_ap_trampoline_start, trampoline_size);
 
     CPUInfo* bsp_info = nullptr;
     for (size_t i = 0; i < m_cpus.size(); i++) {
@@ -310,14 +456,20 @@ void SMPManager::startup_application_processors() {
         return;
     }
 
+    uint64_t startup_timeout = AP_STARTUP_FALLBACK_CYCLES;
+    if (bsp_info->tsc_per_tick)
+        startup_timeout =
+            bsp_info->tsc_per_tick * get_timer_frequency() * AP_STARTUP_TIMEOUT_MS / 1000;
+
     for (size_t i = 0; i < m_cpus.size(); i++) {
         auto& cpu = m_cpus[i];
 
-        if (cpu.is_bsp) continue;
+        if (cpu.is_bsp || !cpu.kernel_stack) continue;
 
         printf("Starting AP CPU %u (LAPIC ID: %u)...\n", cpu.id, cpu.lapic_id);
 
         g_ap_target_cpu = cpu.id;
+        g_ap_stack = cpu.kernel_stack;
 
         uint32_t icr_high = cpu.lapic_id << 24;
         uint32_t icr_low = 0x4500;
@@ -335,9 +487,7 @@ void SMPManager::startup_application_processors() {
             delay(1000);
         }
 
-        for (int j = 0; j < 1000 && !cpu.is_active; j++) {
-            delay(1000);
-        }
+        wait_until_active(cpu, startup_timeout);
 
         if (!cpu.is_active) printf("Failed to start AP CPU %u\n", cpu.id);
     }
@@ -348,11 +498,18 @@ void SMPManager::startup_application_processors() {
 }
 
 uint32_t SMPManager::get_current_cpu_id() {
-    uint64_t apic_base = read_msr(MSR_APIC_BASE);
-    uint32_t current_lapic_id = (apic_base >> 24) & 0xFF;
+    if (m_rdtscp) {
+        uint32_t low, high, aux;
+        asm volatile("rdtscp" : "=a"(low), "=d"(high), "=c"(aux));
+        return aux;
+    }
 
-    for (size_t i = 0; i < m_cpus.size(); i++) {
-        if (m_cpus[i].lapic_id == current_lapic_id) return m_cpus[i].id;
+    if (m_lapic_base) {
+        uint32_t current_lapic_id = lapic_read(m_lapic_base, LAPIC_ID) >> 24;
+
+        for (size_t i = 0; i < m_cpus.size(); i++) {
+            if (m_cpus[i].lapic_id == current_lapic_id) return m_cpus[i].id;
+        }
     }
 
     for (size_t i = 0; i < m_cpus.size(); i++) {
@@ -362,6 +519,12 @@ uint32_t SMPManager::get_current_cpu_id() {
     return 0;
 }
 
+void SMPManager::init_cpu_local(uint32_t cpu_id) {
+    if (!check_rdtscp_available()) return;
+
+    write_msr(MSR_TSC_AUX, cpu_id);
+}
+
 CPUInfo* SMPManager::get_cpu_info(uint32_t id) {
     for (size_t i = 0; i < m_cpus.size(); i++) {
         if (m_cpus[i].id == id) return &m_cpus[i];
@@ -406,6 +569,73 @@ void SMPManager::detect_active_cores() {
     }
 }
 
+bool SMPManager::run_on_cpu(uint32_t cpu_id, CPUWorkFunction function, void* arg) {
+    if (cpu_id >= MAX_CPUS || cpu_id == get_current_cpu_id()) return false;
+
+    CPUInfo* cpu = get_cpu_info(cpu_id);
+    if (!cpu || !cpu->is_active || cpu->is_bsp) return false;
+
+    CPUWork& work = m_work[cpu_id];
+    if (__atomic_load_n(&work.function, __ATOMIC_ACQUIRE)) return false;
+
+    work.arg = arg;
+    __atomic_store_n(&work.function, function, __ATOMIC_RELEASE);
+    send_ipi(cpu_id, IPI_VECTOR);
+    return true;
+}
+
+void SMPManager::wait_for_cpu(uint32_t cpu_id) {
+    if (cpu_id >= MAX_CPUS) return;
+
+    while (__atomic_load_n(&m_work[cpu_id].function, __ATOMIC_ACQUIRE))
+        asm volatile("pause");
+}
+
+void SMPManager::process_cpu_work(uint32_t cpu_id) {
+    CPUWork& work = m_work[cpu_id];
+
+    CPUWorkFunction function = __atomic_load_n(&work.function, __ATOMIC_ACQUIRE);
+    if (!function) return;
+
+    function(work.arg);
+    __atomic_store_n(&work.function, nullptr, __ATOMIC_RELEASE);
+}
+
+bool SMPManager::has_cpu_work(uint32_t cpu_id) const {
+    if (cpu_id >= MAX_CPUS) return false;
+
+    return __atomic_load_n(&m_work[cpu_id].function, __ATOMIC_ACQUIRE) != nullptr;
+}
+
+void SMPManager::handle_ipi() {
+    TLBShootdown::instance().handle_ipi();
+
+    if (m_lapic_base) lapic_write(m_lapic_base, LAPIC_EOI, 0);
+
+    auto& scheduler = Scheduler::instance();
+    CPURunQueue* runqueue = scheduler.get_current_runqueue();
+    if (!runqueue) return;
+
+    if (runqueue->needs_resched)
+        scheduler.schedule();
+    else
+        scheduler.update_tick(runqueue->cpu_id);
+}
+
+void SMPManager::handle_timer() {
+    if (m_lapic_base) lapic_write(m_lapic_base, LAPIC_EOI, 0);
+
+    CPUInfo* cpu_info = get_current_cpu_info();
+    if (!cpu_info) return;
+
+    uint64_t now = get_ticks();
+    uint64_t elapsed = now > cpu_info->last_tick ? now - cpu_info->last_tick : 1;
+    cpu_info->last_tick = now;
+    cpu_info->timer_interrupts++;
+
+    Scheduler::instance().tick(elapsed);
+}
+
 void SMPManager::send_ipi(uint32_t cpu_id, uint8_t vector) {
     CPUInfo* target_cpu = get_cpu_info(cpu_id);
     if (!target_cpu) return;
@@ -7,6 +7,16 @@
 namespace kernel {
 
 constexpr uint8_t IPI_VECTOR = 0x40;
+constexpr uint8_t TIMER_VECTOR = 0x41;
+constexpr uint32_t MAX_CPUS = 16;
+
+using CPUWorkFunction = void (*)(void*);
+
+enum class TimerMode : uint8_t {
+    None,
+    OneShot,
+    TscDeadline,
+};
 
 struct CPUInfo {
     uint32_t id = 0;
@@ -15,6 +25,12 @@ struct CPUInfo {
     void* local_apic_base = nullptr;
     uint64_t kernel_stack = 0;
     uint64_t tss_address = 0;
+    uint32_t timer_count = 0;
+    uint64_t tsc_per_tick = 0;
+    TimerMode timer_mode = TimerMode::None;
+    uint64_t last_tick = 0;
+    uint64_t timer_interrupts = 0;
+    bool tick_stopped = true;
     bool is_active = false;
 };
 
@@ -38,6 +54,8 @@ public:
 
     void set_cpu_active(uint32_t lapic_id);
 
+    void init_cpu_local(uint32_t cpu_id);
+
     void send_ipi(uint32_t cpu_id, uint8_t vector);
 
     void send_ipi_all_excluding_self(uint8_t vector);
@@ -48,7 +66,30 @@ public:
 
     void detect_active_cores();
 
+    bool run_on_cpu(uint32_t cpu_id, CPUWorkFunction function, void* arg);
+
+    void wait_for_cpu(uint32_t cpu_id);
+
+    void process_cpu_work(uint32_t cpu_id);
+
+    bool has_cpu_work(uint32_t cpu_id) const;
+
+    void handle_ipi();
+
+    void handle_timer();
+
+    void setup_local_apic();
+
+    void start_local_timer(uint32_t cpu_id);
+
+    void set_next_tick(uint64_t ticks);
+
 private:
+    struct CPUWork {
+        CPUWorkFunction function = nullptr;
+        void* arg = nullptr;
+    };
+
     SMPManager() = default;
     ~SMPManager() = default;
 
@@ -58,10 +99,15 @@ private:
     void detect_cpus();
     void init_local_apic();
     void init_io_apic();
+    bool calibrate_timer(CPUInfo* cpu_info, uint32_t frequency);
 
     uint32_t m_cpu_count = 1;
     Vector<CPUInfo> m_cpus;
     bool m_smp_enabled = false;
+    bool m_rdtscp = false;
+    bool m_tsc_deadline = false;
+    void* m_lapic_base = nullptr;
+    CPUWork m_work[MAX_CPUS];
 };
 
 }  // namespace kernel
\ No newline at end of file
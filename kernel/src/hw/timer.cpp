@@ -15,11 +15,27 @@ namespace {
 static std::atomic<uint64_t> timer_ticks{0};
 uint32_t timer_frequency = 0;
 
+constexpr uint32_t CPUID_POWER_EDX_INVARIANT_TSC = 1 << 8;
+
+std::atomic<uint64_t> tsc_per_tick{0};
+std::atomic<bool> local_timers{false};
+uint64_t tsc_base = 0;
+uint64_t tick_base = 0;
+
 extern "C" void timer_handler();
 
 extern "C" void timer_callback() {
     timer_ticks.fetch_add(1, std::memory_order_relaxed);
-    kernel::Scheduler::instance().tick();
+    if (!local_timers.load(std::memory_order_relaxed)) kernel::Scheduler::instance().tick();
+}
+
+bool check_invariant_tsc() {
+    uint32_t eax, ebx, ecx, edx;
+    asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0x80000000));
+    if (eax < 0x80000007) return false;
+
+    asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0x80000007));
+    return (edx & CPUID_POWER_EDX_INVARIANT_TSC) != 0;
 }
 
 void append_number(char* buffer, size_t& pos, size_t max_size, uint64_t num) {
@@ -64,9 +80,27 @@ void init_timer(uint32_t frequency) {
 }
 
 uint64_t get_ticks() {
+    uint64_t cycles = tsc_per_tick.load(std::memory_order_acquire);
+    if (cycles) return tick_base + (read_tsc() - tsc_base) / cycles;
+
     return timer_ticks.load(std::memory_order_relaxed);
 }
 
+void use_local_timers(uint64_t cycles_per_tick) {
+    local_timers.store(true, std::memory_order_relaxed);
+    if (!cycles_per_tick || !check_invariant_tsc()) return;
+
+    outb(PIC1_DATA, inb(PIC1_DATA) | 0x01);
+
+    tick_base = timer_ticks.load(std::memory_order_relaxed);
+    tsc_base = read_tsc();
+    tsc_per_tick.store(cycles_per_tick, std::memory_order_release);
+}
+
+uint32_t get_timer_frequency() {
+    return timer_frequency;
+}
+
 uint64_t get_uptime_seconds() {
     if (timer_frequency == 0) return 0;
     return get_ticks() / timer_frequency;
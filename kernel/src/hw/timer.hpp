@@ -6,6 +6,7 @@ constexpr uint16_t PIT_CHANNEL0 = 0x40;
 constexpr uint16_t PIT_CHANNEL1 = 0x41;
 constexpr uint16_t PIT_CHANNEL2 = 0x42;
 constexpr uint16_t PIT_COMMAND = 0x43;
+constexpr uint16_t PIT_GATE = 0x61;
 
 constexpr uint32_t PIT_FREQUENCY = 1193182;
 
@@ -13,6 +14,16 @@ void init_timer(uint32_t frequency = 100);
 
 uint64_t get_ticks();
 
+void use_local_timers(uint64_t cycles_per_tick);
+
+uint32_t get_timer_frequency();
+
 uint64_t get_uptime_seconds();
 
-void format_uptime(char* buffer, size_t size);
\ No newline at end of file
+void format_uptime(char* buffer, size_t size);
+
+inline uint64_t read_tsc() {
+    uint32_t low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return (static_cast<uint64_t>(high) << 32) | low;
+}
\ No newline at end of file
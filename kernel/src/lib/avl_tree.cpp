@@ -0,0 +1,157 @@
+#include "avl_tree.hpp"
+
+namespace kernel {
+
+AVLNode* AVLTree::next(const AVLNode* node) {
+    if (node->right) return leftmost(node->right);
+
+    while (node->parent && node->parent->right == node)
+        node = node->parent;
+    return node->parent;
+}
+
+AVLNode* AVLTree::prev(const AVLNode* node) {
+    if (node->left) {
+        AVLNode* child = node->left;
+        while (child->right)
+            child = child->right;
+        return child;
+    }
+
+    while (node->parent && node->parent->left == node)
+        node = node->parent;
+    return node->parent;
+}
+
+void AVLTree::link_node(AVLNode* node, AVLNode* parent, AVLNode** link) {
+    node->parent = parent;
+    node->left = node->right = nullptr;
+    node->height = 1;
+
+    *link = node;
+    m_count++;
+
+    rebalance(parent);
+}
+
+void AVLTree::remove(AVLNode* node) {
+    AVLNode* rebalance_from;
+
+    if (!node->left || !node->right) {
+        AVLNode* child = node->left ? node->left : node->right;
+        replace_child(node->parent, node, child);
+        if (child) child->parent = node->parent;
+        rebalance_from = node->parent;
+    } else {
+        AVLNode* successor = leftmost(node->right);
+
+        if (successor->parent != node) {
+            rebalance_from = successor->parent;
+            replace_child(successor->parent, successor, successor->right);
+            if (successor->right) successor->right->parent = successor->parent;
+
+            successor->right = node->right;
+            successor->right->parent = successor;
+        } else
+            rebalance_from = successor;
+
+        replace_child(node->parent, node, successor);
+        successor->parent = node->parent;
+        successor->left = node->left;
+        successor->left->parent = successor;
+        successor->height = node->height;
+    }
+
+    node->parent = node->left = node->right = nullptr;
+    m_count--;
+
+    rebalance(rebalance_from);
+}
+
+void AVLTree::reset() {
+    m_root = nullptr;
+    m_count = 0;
+}
+
+void AVLTree::swap(AVLTree& other) {
+    AVLNode* root = m_root;
+    size_t count = m_count;
+    m_root = other.m_root;
+    m_count = other.m_count;
+    other.m_root = root;
+    other.m_count = count;
+}
+
+void AVLTree::update(AVLNode* node) {
+    int32_t left = height(node->left);
+    int32_t right = height(node->right);
+    node->height = (left > right ? left : right) + 1;
+}
+
+AVLNode* AVLTree::leftmost(AVLNode* node) {
+    while (node->left)
+        node = node->left;
+    return node;
+}
+
+void AVLTree::replace_child(AVLNode* parent, AVLNode* old_child, AVLNode* new_child) {
+    if (!parent)
+        m_root = new_child;
+    else if (parent->left == old_child)
+        parent->left = new_child;
+    else
+        parent->right = new_child;
+}
+
+AVLNode* AVLTree::rotate_left(AVLNode* node) {
+    AVLNode* pivot = node->right;
+
+    node->right = pivot->left;
+    if (pivot->left) pivot->left->parent = node;
+
+    replace_child(node->parent, node, pivot);
+    pivot->parent = node->parent;
+
+    pivot->left = node;
+    node->parent = pivot;
+
+    update(node);
+    update(pivot);
+    return pivot;
+}
+
+AVLNode* AVLTree::rotate_right(AVLNode* node) {
+    AVLNode* pivot = node->left;
+
+    node->left = pivot->right;
+    if (pivot->right) pivot->right->parent = node;
+
+    replace_child(node->parent, node, pivot);
+    pivot->parent = node->parent;
+
+    pivot->right = node;
+    node->parent = pivot;
+
+    update(node);
+    update(pivot);
+    return pivot;
+}
+
+void AVLTree::rebalance(AVLNode* node) {
+    while (node) {
+        update(node);
+
+        int32_t balance = height(node->left) - height(node->right);
+        if (balance > 1) {
+            if (height(node->left->left) < height(node->left->right)) rotate_left(node->left);
+            node = rotate_right(node);
+        } else if (balance < -1) {
+            if (height(node->right->right) < height(node->right->left)) rotate_right(node->right);
+            node = rotate_left(node);
+        }
+
+        node = node->parent;
+    }
+}
+
+}  // namespace kernel
\ No newline at end of file
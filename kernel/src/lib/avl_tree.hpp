@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace kernel {
+
+struct AVLNode {
+    AVLNode* parent = nullptr;
+    AVLNode* left = nullptr;
+    AVLNode* right = nullptr;
+    int32_t height = 1;
+};
+
+class AVLTree {
+public:
+    AVLNode* root() const {
+        return m_root;
+    }
+    AVLNode* first() const {
+        return m_root ? leftmost(m_root) : nullptr;
+    }
+    static AVLNode* next(const AVLNode* node);
+    static AVLNode* prev(const AVLNode* node);
+
+    template <typename Less>
+    void insert(AVLNode* node, Less less) {
+        AVLNode* parent = nullptr;
+        AVLNode** link = &m_root;
+        while (*link) {
+            parent = *link;
+            link = less(node, parent) ? &parent->left : &parent->right;
+        }
+
+        link_node(node, parent, link);
+    }
+    void remove(AVLNode* node);
+    void reset();
+    void swap(AVLTree& other);
+
+    size_t count() const {
+        return m_count;
+    }
+
+private:
+    static int32_t height(const AVLNode* node) {
+        return node ? node->height : 0;
+    }
+    static void update(AVLNode* node);
+    static AVLNode* leftmost(AVLNode* node);
+
+    void link_node(AVLNode* node, AVLNode* parent, AVLNode** link);
+    void replace_child(AVLNode* parent, AVLNode* old_child, AVLNode* new_child);
+    AVLNode* rotate_left(AVLNode* node);
+    AVLNode* rotate_right(AVLNode* node);
+    void rebalance(AVLNode* node);
+
+    AVLNode* m_root = nullptr;
+    size_t m_count = 0;
+};
+
+}  // namespace kernel
\ No newline at end of file
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace kernel {
+
+class SummaryBitmap {
+public:
+    static constexpr size_t WORD_BITS = 64;
+    static constexpr size_t NOT_FOUND = static_cast<size_t>(-1);
+
+    static size_t storage_words(size_t bits) {
+        size_t words = (bits + WORD_BITS - 1) / WORD_BITS;
+        return words + (words + WORD_BITS - 1) / WORD_BITS;
+    }
+
+    void initialize(uint64_t* storage, size_t bits) {
+        m_bits = bits;
+        m_word_count = (bits + WORD_BITS - 1) / WORD_BITS;
+        m_summary_count = (m_word_count + WORD_BITS - 1) / WORD_BITS;
+        m_words = storage;
+        m_summary = storage + m_word_count;
+        m_cursor = 0;
+
+        for (size_t i = 0; i < m_word_count + m_summary_count; i++) {
+            storage[i] = 0;
+        }
+    }
+
+    void relocate(uint64_t* storage) {
+        m_words = storage;
+        m_summary = storage + m_word_count;
+    }
+
+    uint64_t* storage() const {
+        return m_words;
+    }
+
+    void set(size_t bit) {
+        size_t word = bit / WORD_BITS;
+        m_words[word] |= 1ULL << (bit % WORD_BITS);
+        m_summary[word / WORD_BITS] |= 1ULL << (word % WORD_BITS);
+    }
+
+    void clear(size_t bit) {
+        size_t word = bit / WORD_BITS;
+        m_words[word] &= ~(1ULL << (bit % WORD_BITS));
+        if (!m_words[word]) m_summary[word / WORD_BITS] &= ~(1ULL << (word % WORD_BITS));
+    }
+
+    bool test(size_t bit) const {
+        return m_words[bit / WORD_BITS] & (1ULL << (bit % WORD_BITS));
+    }
+
+    size_t find_first(size_t from = 0) const {
+        if (from >= m_bits) return NOT_FOUND;
+
+        size_t word = from / WORD_BITS;
+        uint64_t bits = m_words[word] & (~0ULL << (from % WORD_BITS));
+        if (bits) return word * WORD_BITS + __builtin_ctzll(bits);
+
+        word++;
+        if (word >= m_word_count) return NOT_FOUND;
+
+        size_t index = word / WORD_BITS;
+        uint64_t summary = m_summary[index] & (~0ULL << (word % WORD_BITS));
+
+        while (!summary) {
+            if (++index >= m_summary_count) return NOT_FOUND;
+            summary = m_summary[index];
+        }
+
+        word = index * WORD_BITS + __builtin_ctzll(summary);
+        return word * WORD_BITS + __builtin_ctzll(m_words[word]);
+    }
+
+    size_t find_next() {
+        size_t bit = find_first(m_cursor);
+        if (bit == NOT_FOUND && m_cursor) bit = find_first(0);
+        if (bit != NOT_FOUND) m_cursor = bit + 1;
+        return bit;
+    }
+
+    void reset_cursor() {
+        m_cursor = 0;
+    }
+
+private:
+    uint64_t* m_words = nullptr;
+    uint64_t* m_summary = nullptr;
+    size_t m_bits = 0;
+    size_t m_word_count = 0;
+    size_t m_summary_count = 0;
+    size_t m_cursor = 0;
+};
+
+}  // namespace kernel
\ No newline at end of file
@@ -130,6 +130,13 @@ extern "C" int snprintf(char* str, size_t size, const char* format, ...) {
     return strlen(str);
 }
 
+extern "C" char* strdup(const char* str) {
+    size_t len = strlen(str) + 1;
+    char* copy = new char[len];
+    memcpy(copy, str, len);
+    return copy;
+}
+
 extern "C" char* strcat(char* dest, const char* src) {
     char* d = dest;
     while (*d) {
@@ -142,11 +149,11 @@ extern "C" char* strcat(char* dest, const char* src) {
 }
 
 void* operator new(size_t size) {
-    return HeapAllocator::instance().allocate(size);
+    return HeapAllocator::instance().allocate(size, __builtin_return_address(0));
 }
 
 void* operator new[](size_t size) {
-    return HeapAllocator::instance().allocate(size);
+    return HeapAllocator::instance().allocate(size, __builtin_return_address(0));
 }
 
 void operator delete(void* ptr) noexcept {
@@ -2,11 +2,12 @@
 
 #include "terminal.hpp"
 
-extern "C" {
+namespace {
 
 constexpr size_t PRINT_BUFFER_SIZE = 32;
 
-void print_number(int num, int base, int width, bool pad_zero, bool left_justify) {
+void write_number(putchar_function output_char, int num, int base, int width, bool pad_zero,
+                  bool left_justify) {
     bool negative = num < 0;
     if (negative) num = -num;
 
@@ -27,27 +28,28 @@ void print_number(int num, int base, int width, bool pad_zero, bool left_justify
     int padding = width - content_width;
 
     if (left_justify) {
-        if (negative) terminal_putchar('-');
+        if (negative) output_char('-');
 
         while (i-- > 0)
-            terminal_putchar(buffer[i]);
+            output_char(buffer[i]);
 
         while (padding-- > 0)
-            terminal_putchar(' ');
+            output_char(' ');
     } else {
-        if (pad_zero && negative) terminal_putchar('-');
+        if (pad_zero && negative) output_char('-');
 
         while (padding-- > 0)
-            terminal_putchar(pad_zero ? '0' : ' ');
+            output_char(pad_zero ? '0' : ' ');
 
-        if (!pad_zero && negative) terminal_putchar('-');
+        if (!pad_zero && negative) output_char('-');
 
         while (i-- > 0)
-            terminal_putchar(buffer[i]);
+            output_char(buffer[i]);
     }
 }
 
-void print_unsigned(unsigned long long num, int base, int width, bool pad_zero, bool left_justify) {
+void write_unsigned(putchar_function output_char, unsigned long long num, int base, int width,
+                    bool pad_zero, bool left_justify) {
     char buffer[PRINT_BUFFER_SIZE] = {0};
     size_t i = 0;
 
@@ -65,20 +67,21 @@ void print_unsigned(unsigned long long num, int base, int width, bool pad_zero,
 
     if (left_justify) {
         while (i-- > 0)
-            terminal_putchar(buffer[i]);
+            output_char(buffer[i]);
 
         while (padding-- > 0)
-            terminal_putchar(' ');
+            output_char(' ');
     } else {
         while (padding-- > 0)
-            terminal_putchar(pad_zero ? '0' : ' ');
+            output_char(pad_zero ? '0' : ' ');
 
         while (i-- > 0)
-            terminal_putchar(buffer[i]);
+            output_char(buffer[i]);
     }
 }
 
-void print_hex(unsigned long long num, int width, bool pad_zero, bool left_justify) {
+void write_hex(putchar_function output_char, unsigned long long num, int width, bool pad_zero,
+               bool left_justify) {
     char buffer[PRINT_BUFFER_SIZE] = {0};
     size_t i = 0;
 
@@ -95,47 +98,54 @@ void print_hex(unsigned long long num, int width, bool pad_zero, bool left_justi
     int padding = width - i - 2;
 
     if (left_justify) {
-        printf("0x");
+        output_char('0');
+        output_char('x');
         while (i-- > 0)
-            terminal_putchar(buffer[i]);
+            output_char(buffer[i]);
 
         while (padding-- > 0)
-            terminal_putchar(' ');
+            output_char(' ');
     } else {
         while (padding-- > 0)
-            terminal_putchar(pad_zero ? '0' : ' ');
+            output_char(pad_zero ? '0' : ' ');
 
-        printf("0x");
+        output_char('0');
+        output_char('x');
         while (i-- > 0)
-            terminal_putchar(buffer[i]);
+            output_char(buffer[i]);
     }
 }
 
-void print_pointer(const void* ptr) {
-    print_hex(reinterpret_cast<unsigned long long>(ptr));
-}
-
-void print_float(double num, int precision) {
+void write_float(putchar_function output_char, double num, int precision) {
     if (num < 0) {
-        terminal_putchar('-');
+        output_char('-');
         num = -num;
     }
 
     unsigned long integer_part = static_cast<unsigned long>(num);
-    print_unsigned(integer_part, 10, 0, false);
+    write_unsigned(output_char, integer_part, 10, 0, false, false);
 
-    terminal_putchar('.');
+    output_char('.');
 
     double fractional = num - integer_part;
     for (int i = 0; i < precision; i++) {
         fractional *= 10;
         int digit = static_cast<int>(fractional);
-        terminal_putchar('0' + digit);
+        output_char('0' + digit);
         fractional -= digit;
     }
 }
 
-int vprintf(const char* format, va_list args) {
+void write_string(putchar_function output_char, const char* str) {
+    while (*str)
+        output_char(*str++);
+}
+
+}  // namespace
+
+extern "C" {
+
+int vprintf_to(putchar_function output_char, const char* format, va_list args) {
     int written = 0;
 
     while (*format) {
@@ -192,40 +202,48 @@ int vprintf(const char* format, va_list args) {
             switch (*format) {
                 case 'f': {
                     if (precision < 0) precision = 6;
-                    print_float(va_arg(args, double), precision);
+                    write_float(output_char, va_arg(args, double), precision);
                     break;
                 }
                 case 'd':
                     if (is_size_t)
-                        print_unsigned(va_arg(args, size_t), 10, width, pad_zero, left_justify);
+                        write_unsigned(output_char, va_arg(args, size_t), 10, width, pad_zero,
+                                       left_justify);
                     else if (is_long_long)
-                        print_number(va_arg(args, long long), 10, width, pad_zero, left_justify);
+                        write_number(output_char, va_arg(args, long long), 10, width, pad_zero,
+                                     left_justify);
                     else if (is_long)
-                        print_number(va_arg(args, long), 10, width, pad_zero, left_justify);
+                        write_number(output_char, va_arg(args, long), 10, width, pad_zero,
+                                     left_justify);
                     else
-                        print_number(va_arg(args, int), 10, width, pad_zero, left_justify);
+                        write_number(output_char, va_arg(args, int), 10, width, pad_zero,
+                                     left_justify);
                     break;
                 case 'u':
                     if (is_size_t || is_long_long)
-                        print_unsigned(va_arg(args, unsigned long long), 10, width, pad_zero,
-                                       left_justify);
+                        write_unsigned(output_char, va_arg(args, unsigned long long), 10, width,
+                                       pad_zero, left_justify);
                     else if (is_long)
-                        print_unsigned(va_arg(args, unsigned long), 10, width, pad_zero,
-                                       left_justify);
+                        write_unsigned(output_char, va_arg(args, unsigned long), 10, width,
+                                       pad_zero, left_justify);
                     else
-                        print_unsigned(va_arg(args, unsigned int), 10, width, pad_zero,
+                        write_unsigned(output_char, va_arg(args, unsigned int), 10, width, pad_zero,
                                        left_justify);
                     break;
                 case 'x':
                     if (is_size_t || is_long_long)
-                        print_hex(va_arg(args, unsigned long long), width, pad_zero, left_justify);
+                        write_hex(output_char, va_arg(args, unsigned long long), width, pad_zero,
+                                  left_justify);
                     else if (is_long)
-                        print_hex(va_arg(args, unsigned long), width, pad_zero, left_justify);
+                        write_hex(output_char, va_arg(args, unsigned long), width, pad_zero,
+                                  left_justify);
                     else
-                        print_hex(va_arg(args, unsigned int), width, pad_zero, left_justify);
+                        write_hex(output_char, va_arg(args, unsigned int), width, pad_zero,
+                                  left_justify);
                     break;
                 case 'p':
-                    print_pointer(va_arg(args, void*));
+                    write_hex(output_char, reinterpret_cast<uintptr_t>(va_arg(args, void*)), 0,
+                              false, false);
                     break;
                 case 's': {
                     const char* str = va_arg(args, const char*);
@@ -240,33 +258,33 @@ int vprintf(const char* format, va_list args) {
                         }
 
                         if (left_justify) {
-                            printf(str);
+                            write_string(output_char, str);
                             int padding = width - len;
                             while (padding-- > 0)
-                                terminal_putchar(' ');
+                                output_char(' ');
                         } else {
                             int padding = width - len;
                             while (padding-- > 0)
-                                terminal_putchar(' ');
-                            printf(str);
+                                output_char(' ');
+                            write_string(output_char, str);
                         }
                     } else
-                        printf(str);
+                        write_string(output_char, str);
                     break;
                 }
                 case '%':
-                    terminal_putchar('%');
+                    output_char('%');
                     break;
                 case 'c':
-                    terminal_putchar(va_arg(args, int));
+                    output_char(va_arg(args, int));
                     break;
                 default:
-                    terminal_putchar('%');
-                    terminal_putchar(*format);
+                    output_char('%');
+                    output_char(*format);
                     break;
             }
         } else
-            terminal_putchar(*format);
+            output_char(*format);
         format++;
         written++;
     }
@@ -274,6 +292,10 @@ int vprintf(const char* format, va_list args) {
     return written;
 }
 
+int vprintf(const char* format, va_list args) {
+    return vprintf_to(terminal_putchar, format, args);
+}
+
 int printf(const char* format, ...) {
     va_list args;
     va_start(args, format);
@@ -282,4 +304,28 @@ int printf(const char* format, ...) {
     return ret;
 }
 
+int printf_to(putchar_function output_char, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    int ret = vprintf_to(output_char, format, args);
+    va_end(args);
+    return ret;
+}
+
+void print_number(int num, int base, int width, bool pad_zero, bool left_justify) {
+    write_number(terminal_putchar, num, base, width, pad_zero, left_justify);
+}
+
+void print_unsigned(unsigned long long num, int base, int width, bool pad_zero, bool left_justify) {
+    write_unsigned(terminal_putchar, num, base, width, pad_zero, left_justify);
+}
+
+void print_hex(unsigned long long num, int width, bool pad_zero, bool left_justify) {
+    write_hex(terminal_putchar, num, width, pad_zero, left_justify);
+}
+
+void print_pointer(const void* ptr) {
+    print_hex(reinterpret_cast<uintptr_t>(ptr));
+}
+
 }  // extern "C"
\ No newline at end of file
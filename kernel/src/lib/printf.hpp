@@ -7,8 +7,12 @@
 extern "C" {
 #endif
 
+typedef void (*putchar_function)(char);
+
 int printf(const char* format, ...);
 int vprintf(const char* format, va_list args);
+int printf_to(putchar_function output_char, const char* format, ...);
+int vprintf_to(putchar_function output_char, const char* format, va_list args);
 
 void print_number(int num, int base = 10, int width = 0, bool pad_zero = false,
                   bool left_justify = false);
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+
+namespace kernel {
+
+class Spinlock {
+public:
+    void lock() {
+        while (__atomic_test_and_set(&m_locked, __ATOMIC_ACQUIRE)) {
+            while (__atomic_load_n(&m_locked, __ATOMIC_RELAXED))
+                asm volatile("pause");
+        }
+    }
+
+    bool try_lock() {
+        return !__atomic_test_and_set(&m_locked, __ATOMIC_ACQUIRE);
+    }
+
+    void unlock() {
+        __atomic_clear(&m_locked, __ATOMIC_RELEASE);
+    }
+
+    uint64_t lock_irqsave() {
+        uint64_t flags = save_irq();
+        lock();
+        return flags;
+    }
+
+    void unlock_irqrestore(uint64_t flags) {
+        unlock();
+        restore_irq(flags);
+    }
+
+    bool is_locked() const {
+        return __atomic_load_n(&m_locked, __ATOMIC_RELAXED);
+    }
+
+    static uint64_t save_irq() {
+        uint64_t flags;
+        asm volatile("pushfq; pop %0; cli" : "=r"(flags) : : "memory");
+        return flags;
+    }
+
+    static void restore_irq(uint64_t flags) {
+        if (flags & (1 << 9)) asm volatile("sti" : : : "memory");
+    }
+
+private:
+    bool m_locked = false;
+};
+
+class ScopedLock {
+public:
+    explicit ScopedLock(Spinlock& lock) : m_lock(lock) {
+        m_flags = m_lock.lock_irqsave();
+    }
+
+    ~ScopedLock() {
+        m_lock.unlock_irqrestore(m_flags);
+    }
+
+    ScopedLock(const ScopedLock&) = delete;
+    ScopedLock& operator=(const ScopedLock&) = delete;
+
+private:
+    Spinlock& m_lock;
+    uint64_t m_flags = 0;
+};
+
+}  // namespace kernel
\ No newline at end of file
@@ -1,10 +1,269 @@
 #include "heap.hpp"
 
-#include <cstring>
-
+#include "heap_profiler.hpp"
+#include "hw/smp.hpp"
 #include "physical_memory.hpp"
+#include "virtual_memory.hpp"
+
+namespace {
+constexpr size_t HEADER_SIZE = 2 * sizeof(uintptr_t);
+constexpr size_t ALIGNMENT = 16;
+constexpr size_t MIN_BLOCK_SIZE = sizeof(HeapBlock) - HEADER_SIZE;
+
+constexpr size_t BLOCK_FREE = 1;
+constexpr size_t PREV_FREE = 2;
+constexpr size_t TAGGED = 4;
+constexpr size_t FLAG_MASK = BLOCK_FREE | PREV_FREE | TAGGED;
+
+size_t block_size(const HeapBlock* block) {
+    return block->size & ~FLAG_MASK;
+}
+
+bool is_free(const HeapBlock* block) {
+    return block->size & BLOCK_FREE;
+}
+
+void set_size(HeapBlock* block, size_t size) {
+    block->size = size | (block->size & FLAG_MASK);
+}
+
+void set_flag(HeapBlock* block, size_t flag, bool value) {
+    block->size = value ? (block->size | flag) : (block->size & ~flag);
+}
+
+HeapBlock* next_physical(HeapBlock* block) {
+    return reinterpret_cast<HeapBlock*>(reinterpret_cast<uint8_t*>(block) + HEADER_SIZE +
+                                        block_size(block));
+}
+
+void* payload(HeapBlock* block) {
+    return reinterpret_cast<uint8_t*>(block) + HEADER_SIZE;
+}
+
+const HeapBlock* header(const void* ptr) {
+    return reinterpret_cast<const HeapBlock*>(static_cast<const uint8_t*>(ptr) - HEADER_SIZE);
+}
+
+size_t fls(size_t value) {
+    return 63 - __builtin_clzll(value);
+}
+}  // namespace
+
+static_assert(HeapAllocator::MAX_ARENAS >= kernel::MAX_CPUS);
+
+void HeapArena::add_region(uintptr_t start, size_t size) {
+    kernel::ScopedLock guard(m_lock);
+
+    auto* block = reinterpret_cast<HeapBlock*>(start);
+    block->prev_physical = nullptr;
+    block->size = size - 2 * HEADER_SIZE;
+
+    HeapBlock* sentinel = next_physical(block);
+    sentinel->prev_physical = block;
+    sentinel->size = 0;
+
+    m_total_size += size;
+    m_used_memory += 2 * HEADER_SIZE;
+    m_stats.chunks++;
+
+    set_flag(block, BLOCK_FREE, true);
+    set_flag(sentinel, PREV_FREE, true);
+    insert_block(block);
+}
+
+void HeapArena::mapping(size_t size, size_t& fl, size_t& sl) {
+    if (size < SMALL_BLOCK) {
+        fl = 0;
+        sl = size / (SMALL_BLOCK / SL_COUNT);
+        return;
+    }
+
+    size_t bit = fls(size);
+    sl = (size >> (bit - SL_SHIFT)) ^ SL_COUNT;
+    fl = bit - (FL_SHIFT - 1);
+}
+
+HeapBlock* HeapArena::find_free_block(size_t size) {
+    size_t fl, sl;
+    mapping(size, fl, sl);
+    if (fl >= FL_COUNT) return nullptr;
+
+    HeapBlock* exact = m_blocks[fl][sl];
+    if (exact && block_size(exact) < size) exact = nullptr;
+
+    if (size >= SMALL_BLOCK) mapping(size + (1ULL << (fls(size) - SL_SHIFT)) - 1, fl, sl);
+    if (fl >= FL_COUNT) return exact;
+
+    uint32_t sl_map = m_sl_bitmap[fl] & (~0U << sl);
+    if (!sl_map) {
+        uint32_t fl_map = fl + 1 < 32 ? m_fl_bitmap & (~0U << (fl + 1)) : 0;
+        if (!fl_map) return exact;
+
+        fl = __builtin_ctz(fl_map);
+        sl_map = m_sl_bitmap[fl];
+    }
 
-constexpr size_t PAGE_SIZE = 4096;
+    return m_blocks[fl][__builtin_ctz(sl_map)];
+}
+
+void HeapArena::insert_block(HeapBlock* block) {
+    size_t fl, sl;
+    mapping(block_size(block), fl, sl);
+
+    block->prev_free = nullptr;
+    block->next_free = m_blocks[fl][sl];
+    if (block->next_free) block->next_free->prev_free = block;
+
+    m_blocks[fl][sl] = block;
+    m_fl_bitmap |= 1U << fl;
+    m_sl_bitmap[fl] |= 1U << sl;
+}
+
+void HeapArena::remove_block(HeapBlock* block) {
+    size_t fl, sl;
+    mapping(block_size(block), fl, sl);
+
+    if (block->prev_free)
+        block->prev_free->next_free = block->next_free;
+    else
+        m_blocks[fl][sl] = block->next_free;
+
+    if (block->next_free) block->next_free->prev_free = block->prev_free;
+
+    if (!m_blocks[fl][sl]) {
+        m_sl_bitmap[fl] &= ~(1U << sl);
+        if (!m_sl_bitmap[fl]) m_fl_bitmap &= ~(1U << fl);
+    }
+}
+
+void HeapArena::split_block(HeapBlock* block, size_t size) {
+    size_t total = block_size(block);
+    if (total < size + HEADER_SIZE + MIN_BLOCK_SIZE) return;
+
+    set_size(block, size);
+
+    HeapBlock* remainder = next_physical(block);
+    remainder->prev_physical = block;
+    remainder->size = (total - size - HEADER_SIZE) | BLOCK_FREE;
+
+    next_physical(remainder)->prev_physical = remainder;
+    m_used_memory += HEADER_SIZE;
+
+    insert_block(merge_block(remainder));
+}
+
+HeapBlock* HeapArena::merge_block(HeapBlock* block) {
+    HeapBlock* next = next_physical(block);
+    if (is_free(next)) {
+        remove_block(next);
+        set_size(block, block_size(block) + HEADER_SIZE + block_size(next));
+        next_physical(block)->prev_physical = block;
+        m_used_memory -= HEADER_SIZE;
+    }
+
+    if (block->size & PREV_FREE) {
+        HeapBlock* prev = block->prev_physical;
+        remove_block(prev);
+        set_size(prev, block_size(prev) + HEADER_SIZE + block_size(block));
+        next_physical(prev)->prev_physical = prev;
+        m_used_memory -= HEADER_SIZE;
+        block = prev;
+    }
+
+    set_flag(next_physical(block), PREV_FREE, true);
+    return block;
+}
+
+void* HeapArena::allocate(size_t size, bool tagged) {
+    kernel::ScopedLock guard(m_lock);
+
+    if (__atomic_load_n(&m_remote_free, __ATOMIC_RELAXED)) drain_remote();
+
+    HeapBlock* block = find_free_block(size);
+    if (!block) return nullptr;
+
+    remove_block(block);
+    set_flag(block, BLOCK_FREE, false);
+    set_flag(block, TAGGED, tagged);
+    set_flag(next_physical(block), PREV_FREE, false);
+    split_block(block, size);
+
+    m_used_memory += block_size(block);
+    m_stats.allocations++;
+
+    return payload(block);
+}
+
+void HeapArena::free(void* ptr) {
+    auto* block = reinterpret_cast<HeapBlock*>(static_cast<uint8_t*>(ptr) - HEADER_SIZE);
+
+    kernel::ScopedLock guard(m_lock);
+
+    if (__atomic_load_n(&m_remote_free, __ATOMIC_RELAXED)) drain_remote();
+    release_block(block);
+}
+
+void HeapArena::push_remote(void* ptr) {
+    auto* block = reinterpret_cast<HeapBlock*>(static_cast<uint8_t*>(ptr) - HEADER_SIZE);
+
+    HeapBlock* head = __atomic_load_n(&m_remote_free, __ATOMIC_RELAXED);
+    do {
+        block->next_free = head;
+    } while (!__atomic_compare_exchange_n(&m_remote_free, &head, block, true, __ATOMIC_RELEASE,
+                                          __ATOMIC_RELAXED));
+}
+
+void HeapArena::drain_remote() {
+    HeapBlock* block = __atomic_exchange_n(&m_remote_free, nullptr, __ATOMIC_ACQUIRE);
+
+    while (block) {
+        HeapBlock* next = block->next_free;
+        release_block(block);
+        m_stats.remote_frees++;
+        block = next;
+    }
+}
+
+void HeapArena::release_block(HeapBlock* block) {
+    if (is_free(block)) return;
+
+    m_used_memory -= block_size(block);
+    m_stats.frees++;
+    set_flag(block, TAGGED, false);
+    set_flag(block, BLOCK_FREE, true);
+    block = merge_block(block);
+
+    size_t region_size = block_size(block) + 2 * HEADER_SIZE;
+    if (!block->prev_physical && block_size(next_physical(block)) == 0 &&
+        m_total_size > region_size) {
+        m_total_size -= region_size;
+        m_used_memory -= 2 * HEADER_SIZE;
+        m_stats.chunks--;
+
+        block->next_free = m_empty_regions;
+        m_empty_regions = block;
+        return;
+    }
+
+    insert_block(block);
+}
+
+bool HeapArena::is_tagged(const void* ptr) {
+    return header(ptr)->size & TAGGED;
+}
+
+size_t HeapArena::usable_size(const void* ptr) {
+    return block_size(header(ptr));
+}
+
+uintptr_t HeapArena::take_empty_region() {
+    kernel::ScopedLock guard(m_lock);
+
+    HeapBlock* region = m_empty_regions;
+    if (region) m_empty_regions = region->next_free;
+
+    return reinterpret_cast<uintptr_t>(region);
+}
 
 HeapAllocator& HeapAllocator::instance() {
     static HeapAllocator instance;
@@ -12,103 +271,213 @@ HeapAllocator& HeapAllocator::instance() {
 }
 
 void HeapAllocator::initialize(uintptr_t heap_start, size_t heap_size) {
-    m_first_block = reinterpret_cast<HeapBlock*>(heap_start);
-    m_first_block->size = heap_size - sizeof(HeapBlock);
-    m_first_block->free = true;
-    m_first_block->next = nullptr;
+    m_heap_start = (heap_start + CHUNK_SIZE - 1) & ~(CHUNK_SIZE - 1);
+    m_chunk_count = (heap_size - (m_heap_start - heap_start)) / CHUNK_SIZE;
+    if (m_chunk_count > MAX_CHUNKS) m_chunk_count = MAX_CHUNKS;
+    m_free_chunks = m_chunk_count;
 
-    m_total_size = heap_size;
-    m_used_memory = sizeof(HeapBlock);
+    for (size_t i = 0; i < MAX_CHUNKS; i++) {
+        m_chunk_owner[i] = CHUNK_FREE;
+        m_chunk_run[i] = 0;
+        m_chunk_site[i] = 0;
+    }
+}
+
+size_t HeapAllocator::current_arena() const {
+    uint32_t cpu_id = kernel::SMPManager::instance().get_current_cpu_id();
+    return cpu_id < MAX_ARENAS ? cpu_id : 0;
 }
 
-HeapBlock* HeapAllocator::find_free_block(size_t size) {
-    HeapBlock* current = m_first_block;
-    while (current) {
-        if (current->free && current->size >= size) return current;
-        current = current->next;
+uintptr_t HeapAllocator::allocate_chunks(size_t count, uint8_t owner) {
+    kernel::ScopedLock guard(m_lock);
+
+    constexpr size_t LARGE_PAGE_CHUNKS = VirtualMemoryManager::LARGE_PAGE_SIZE / CHUNK_SIZE;
+    size_t alignment = count >= LARGE_PAGE_CHUNKS ? LARGE_PAGE_CHUNKS : 1;
+
+    size_t run = 0;
+    for (size_t i = 0; i < m_chunk_count; i++) {
+        run = m_chunk_owner[i] == CHUNK_FREE ? run + 1 : 0;
+        if (run < count) continue;
+
+        size_t first = i + 1 - count;
+        if (first % alignment) continue;
+        if (!map_chunks(first, count)) return 0;
+
+        for (size_t j = first; j <= i; j++) {
+            m_chunk_owner[j] = owner;
+        }
+        m_chunk_run[first] = count;
+        m_free_chunks -= count;
+
+        return m_heap_start + first * CHUNK_SIZE;
     }
-    return nullptr;
+
+    return 0;
 }
 
-void HeapAllocator::split_block(HeapBlock* block, size_t size) {
-    if (block->size >= size + sizeof(HeapBlock) + 32) {
-        HeapBlock* new_block = reinterpret_cast<HeapBlock*>(reinterpret_cast<uint8_t*>(block) +
-                                                            sizeof(HeapBlock) + size);
+void HeapAllocator::free_chunks(size_t index) {
+    size_t count = m_chunk_run[index];
+    if (!unmap_chunks(index, count)) return;
 
-        new_block->size = block->size - size - sizeof(HeapBlock);
-        new_block->free = true;
-        new_block->next = block->next;
+    kernel::ScopedLock guard(m_lock);
 
-        block->size = size;
-        block->next = new_block;
+    for (size_t i = index; i < index + count; i++) {
+        m_chunk_owner[i] = CHUNK_FREE;
+    }
+    m_chunk_run[index] = 0;
+    m_chunk_site[index] = 0;
+    m_free_chunks += count;
+}
 
-        m_used_memory += sizeof(HeapBlock);
+bool HeapAllocator::map_chunks(size_t first, size_t count) {
+    auto& pmm = PhysicalMemoryManager::instance();
+    auto& vmm = VirtualMemoryManager::instance();
+
+    uintptr_t start = m_heap_start + first * CHUNK_SIZE;
+    uintptr_t end = start + count * CHUNK_SIZE;
+
+    if (count * CHUNK_SIZE >= VirtualMemoryManager::LARGE_PAGE_SIZE &&
+        start % VirtualMemoryManager::LARGE_PAGE_SIZE == 0) {
+        size_t pages = count * CHUNK_SIZE / PhysicalMemoryManager::PAGE_SIZE;
+        void* frames = pmm.allocate_contiguous(pages, VirtualMemoryManager::LARGE_PAGE_SIZE);
+        if (frames) {
+            if (vmm.map_range(start, reinterpret_cast<uintptr_t>(frames), end - start))
+                return true;
+
+            if (!vmm.unmap_range(start, end - start)) return false;
+            pmm.free_contiguous(frames, pages);
+        }
+    }
+
+    for (uintptr_t addr = start; addr < end; addr += PhysicalMemoryManager::PAGE_SIZE) {
+        void* frame = pmm.allocate_frame();
+        if (!frame || !vmm.map_page(addr, reinterpret_cast<uintptr_t>(frame), true)) {
+            if (frame) pmm.free_frame(frame);
+            vmm.unmap_range(start, addr - start, true);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool HeapAllocator::unmap_chunks(size_t first, size_t count) {
+    uintptr_t start = m_heap_start + first * CHUNK_SIZE;
+    return VirtualMemoryManager::instance().unmap_range(start, count * CHUNK_SIZE, true);
+}
+
+void HeapAllocator::reclaim(HeapArena& arena) {
+    while (arena.has_empty_regions()) {
+        uintptr_t region = arena.take_empty_region();
+        if (!region) break;
+
+        free_chunks((region - m_heap_start) / CHUNK_SIZE);
     }
 }
 
 void* HeapAllocator::allocate(size_t size) {
-    if (size == 0) return nullptr;
+    return allocate(size, __builtin_return_address(0));
+}
 
-    size = (size + 15) & ~15;
-    HeapBlock* block = find_free_block(size);
+void* HeapAllocator::allocate(size_t size, void* caller) {
+    if (size == 0 || m_chunk_count == 0) return nullptr;
 
-    if (!block) return nullptr;
+    auto& profiler = HeapProfiler::instance();
+    bool tagged = profiler.is_enabled();
+    size_t requested = size;
 
-    split_block(block, size);
-    block->free = false;
-    m_used_memory += size;
+    size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    if (size < MIN_BLOCK_SIZE) size = MIN_BLOCK_SIZE;
 
-    auto& pmm = PhysicalMemoryManager::instance();
-    size_t num_pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
-    for (size_t i = 0; i < num_pages; i++) {
-        void* frame = pmm.allocate_frame();
-        if (!frame) {
-            for (size_t j = 0; j < i; j++) {
-                pmm.free_frame(
-                    reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(block) + j * PAGE_SIZE));
-            }
-            return nullptr;
+    if (size > LARGE_THRESHOLD) {
+        size_t count = (size + CHUNK_SIZE - 1) / CHUNK_SIZE;
+        uintptr_t chunk = allocate_chunks(count, CHUNK_LARGE);
+        if (chunk && tagged) {
+            uint32_t site = profiler.record_allocation(requested, count * CHUNK_SIZE, caller);
+            m_chunk_site[(chunk - m_heap_start) / CHUNK_SIZE] = site + 1;
         }
+        return reinterpret_cast<void*>(chunk);
+    }
+
+    if (tagged) size += sizeof(AllocationTag);
+
+    size_t index = current_arena();
+    HeapArena& arena = m_arenas[index];
+
+    void* ptr = arena.allocate(size, tagged);
+    if (arena.has_empty_regions()) reclaim(arena);
+
+    if (!ptr) {
+        uintptr_t chunk = allocate_chunks(1, index);
+        if (!chunk) return nullptr;
+
+        arena.add_region(chunk, CHUNK_SIZE);
+        ptr = arena.allocate(size, tagged);
+        if (!ptr) return nullptr;
     }
 
-    return reinterpret_cast<uint8_t*>(block) + sizeof(HeapBlock);
+    if (tagged) {
+        auto* tag = reinterpret_cast<AllocationTag*>(static_cast<uint8_t*>(ptr) +
+                                                     HeapArena::usable_size(ptr) -
+                                                     sizeof(AllocationTag));
+        tag->site = profiler.record_allocation(requested, requested, caller);
+        tag->size = requested;
+    }
+
+    return ptr;
 }
 
-void HeapAllocator::merge_free_blocks() {
-    HeapBlock* current = m_first_block;
+void HeapAllocator::record_free(void* ptr, size_t index) {
+    auto& profiler = HeapProfiler::instance();
 
-    while (current && current->next) {
-        if (current->free && current->next->free) {
-            current->size += sizeof(HeapBlock) + current->next->size;
-            current->next = current->next->next;
-            m_used_memory -= sizeof(HeapBlock);
-        } else
-            current = current->next;
+    if (m_chunk_owner[index] == CHUNK_LARGE) {
+        if (m_chunk_site[index])
+            profiler.record_free(m_chunk_site[index] - 1, m_chunk_run[index] * CHUNK_SIZE);
+        return;
     }
+
+    if (!HeapArena::is_tagged(ptr)) return;
+
+    auto* tag = reinterpret_cast<const AllocationTag*>(static_cast<uint8_t*>(ptr) +
+                                                       HeapArena::usable_size(ptr) -
+                                                       sizeof(AllocationTag));
+    profiler.record_free(tag->site, tag->size);
 }
 
 void HeapAllocator::free(void* ptr) {
-    if (!ptr) return;
+    uintptr_t addr = reinterpret_cast<uintptr_t>(ptr);
+    if (addr < m_heap_start || addr >= m_heap_start + m_chunk_count * CHUNK_SIZE) return;
 
-    HeapBlock* block =
-        reinterpret_cast<HeapBlock*>(reinterpret_cast<uint8_t*>(ptr) - sizeof(HeapBlock));
+    size_t index = (addr - m_heap_start) / CHUNK_SIZE;
+    uint8_t owner = m_chunk_owner[index];
 
-    auto& pmm = PhysicalMemoryManager::instance();
-    size_t num_pages = (block->size + PAGE_SIZE - 1) / PAGE_SIZE;
-    for (size_t i = 0; i < num_pages; i++) {
-        pmm.free_frame(reinterpret_cast<void*>(reinterpret_cast<uintptr_t>(block) + i * PAGE_SIZE));
+    if (owner == CHUNK_FREE) return;
+
+    if (owner == CHUNK_LARGE) {
+        if (addr == m_heap_start + index * CHUNK_SIZE && m_chunk_run[index]) {
+            record_free(ptr, index);
+            free_chunks(index);
+        }
+        return;
     }
 
-    block->free = true;
-    m_used_memory -= block->size;
+    record_free(ptr, index);
 
-    merge_free_blocks();
+    if (owner == current_arena()) {
+        m_arenas[owner].free(ptr);
+        if (m_arenas[owner].has_empty_regions()) reclaim(m_arenas[owner]);
+    } else
+        m_arenas[owner].push_remote(ptr);
 }
 
 size_t HeapAllocator::get_free_memory() const {
-    return m_total_size - m_used_memory;
+    size_t free_memory = m_free_chunks * CHUNK_SIZE;
+    for (size_t i = 0; i < MAX_ARENAS; i++) {
+        free_memory += m_arenas[i].get_free_memory();
+    }
+    return free_memory;
 }
 
 size_t HeapAllocator::get_used_memory() const {
-    return m_used_memory;
+    return m_chunk_count * CHUNK_SIZE - get_free_memory();
 }
\ No newline at end of file
@@ -3,35 +3,136 @@
 #include <cstddef>
 #include <cstdint>
 
+#include "lib/spinlock.hpp"
+
 struct HeapBlock {
+    HeapBlock* prev_physical = nullptr;
     size_t size = 0;
-    bool free = true;
-    HeapBlock* next = nullptr;
+    HeapBlock* next_free = nullptr;
+    HeapBlock* prev_free = nullptr;
+};
+
+struct HeapArenaStats {
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    uint64_t remote_frees = 0;
+    size_t chunks = 0;
+};
+
+class HeapArena {
+public:
+    void add_region(uintptr_t start, size_t size);
+    void* allocate(size_t size, bool tagged = false);
+    void free(void* ptr);
+    void push_remote(void* ptr);
+
+    static bool is_tagged(const void* ptr);
+    static size_t usable_size(const void* ptr);
+    uintptr_t take_empty_region();
+
+    bool has_empty_regions() const {
+        return m_empty_regions;
+    }
+    size_t get_free_memory() const {
+        return m_total_size - m_used_memory;
+    }
+    size_t get_total_size() const {
+        return m_total_size;
+    }
+    const HeapArenaStats& get_stats() const {
+        return m_stats;
+    }
+
+private:
+    static constexpr size_t ALIGN_SHIFT = 4;
+    static constexpr size_t SL_SHIFT = 4;
+    static constexpr size_t SL_COUNT = 1ULL << SL_SHIFT;
+    static constexpr size_t FL_SHIFT = SL_SHIFT + ALIGN_SHIFT;
+    static constexpr size_t FL_MAX = 32;
+    static constexpr size_t FL_COUNT = FL_MAX - FL_SHIFT + 1;
+    static constexpr size_t SMALL_BLOCK = 1ULL << FL_SHIFT;
+
+    static void mapping(size_t size, size_t& fl, size_t& sl);
+    HeapBlock* find_free_block(size_t size);
+    void insert_block(HeapBlock* block);
+    void remove_block(HeapBlock* block);
+    void split_block(HeapBlock* block, size_t size);
+    HeapBlock* merge_block(HeapBlock* block);
+    void release_block(HeapBlock* block);
+    void drain_remote();
+
+    HeapBlock* m_blocks[FL_COUNT][SL_COUNT] = {};
+    uint32_t m_fl_bitmap = 0;
+    uint32_t m_sl_bitmap[FL_COUNT] = {};
+
+    size_t m_total_size = 0;
+    size_t m_used_memory = 0;
+    HeapArenaStats m_stats;
+    HeapBlock* m_remote_free = nullptr;
+    HeapBlock* m_empty_regions = nullptr;
+    kernel::Spinlock m_lock;
 };
 
 class HeapAllocator {
 public:
+    static constexpr size_t MAX_ARENAS = 16;
+    static constexpr size_t CHUNK_SIZE = 256 * 1024;
+    static constexpr uintptr_t VIRTUAL_BASE = 0xFFFFC00000000000;
+    static constexpr size_t MAX_CHUNKS = 4096;
+    static constexpr size_t MAX_SIZE = MAX_CHUNKS * CHUNK_SIZE;
+    static constexpr size_t LARGE_THRESHOLD = CHUNK_SIZE / 2;
+
     static HeapAllocator& instance();
 
-    void initialize(uintptr_t heap_start, size_t heap_size);
+    void initialize(uintptr_t heap_start = VIRTUAL_BASE, size_t heap_size = MAX_SIZE);
     void* allocate(size_t size);
+    void* allocate(size_t size, void* caller);
     void free(void* ptr);
 
     size_t get_free_memory() const;
     size_t get_used_memory() const;
 
+    const HeapArena& get_arena(size_t index) const {
+        return m_arenas[index < MAX_ARENAS ? index : 0];
+    }
+    size_t get_free_chunks() const {
+        return m_free_chunks;
+    }
+    size_t get_mapped_bytes() const {
+        return (m_chunk_count - m_free_chunks) * CHUNK_SIZE;
+    }
+
 private:
+    static constexpr uint8_t CHUNK_FREE = 0xFF;
+    static constexpr uint8_t CHUNK_LARGE = 0xFE;
+
+    struct AllocationTag {
+        uint32_t site;
+        uint32_t reserved;
+        uint64_t size;
+    };
+
     HeapAllocator() = default;
     ~HeapAllocator() = default;
 
     HeapAllocator(const HeapAllocator&) = delete;
     HeapAllocator& operator=(const HeapAllocator&) = delete;
 
-    HeapBlock* find_free_block(size_t size);
-    void split_block(HeapBlock* block, size_t size);
-    void merge_free_blocks();
+    size_t current_arena() const;
+    uintptr_t allocate_chunks(size_t count, uint8_t owner);
+    void free_chunks(size_t index);
+    bool map_chunks(size_t first, size_t count);
+    bool unmap_chunks(size_t first, size_t count);
+    void reclaim(HeapArena& arena);
+    void record_free(void* ptr, size_t index);
 
-    HeapBlock* m_first_block = nullptr;
-    size_t m_total_size = 0;
-    size_t m_used_memory = 0;
+    HeapArena m_arenas[MAX_ARENAS];
+
+    uintptr_t m_heap_start = 0;
+    size_t m_chunk_count = 0;
+    size_t m_free_chunks = 0;
+    uint8_t m_chunk_owner[MAX_CHUNKS] = {};
+    uint16_t m_chunk_run[MAX_CHUNKS] = {};
+    uint32_t m_chunk_site[MAX_CHUNKS] = {};
+    kernel::Spinlock m_lock;
 };
\ No newline at end of file
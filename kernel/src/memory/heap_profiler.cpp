@@ -0,0 +1,129 @@
+#include "heap_profiler.hpp"
+
+#include "printf.hpp"
+#include "timer.hpp"
+
+namespace {
+constexpr size_t TOP_SITES = 10;
+}  // namespace
+
+HeapProfiler& HeapProfiler::instance() {
+    static HeapProfiler instance;
+    return instance;
+}
+
+size_t HeapProfiler::size_class(size_t size) {
+    if (size <= 16) return 0;
+
+    size_t bit = 64 - __builtin_clzll(size - 1);
+    return bit - 4 < SIZE_CLASSES ? bit - 4 : SIZE_CLASSES - 1;
+}
+
+uint32_t HeapProfiler::find_site(void* caller) {
+    size_t hash = (reinterpret_cast<uintptr_t>(caller) * 0x9E3779B97F4A7C15ULL) >> 56;
+
+    for (size_t probe = 0; probe < MAX_SITES; probe++) {
+        size_t index = (hash + probe) % MAX_SITES;
+        void* current = __atomic_load_n(&m_sites[index].caller, __ATOMIC_ACQUIRE);
+
+        if (current == caller) return index;
+        if (current) continue;
+
+        if (__atomic_compare_exchange_n(&m_sites[index].caller, &current, caller, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) ||
+            current == caller)
+            return index;
+    }
+
+    __atomic_fetch_add(&m_dropped_sites, 1, __ATOMIC_RELAXED);
+    return NO_SITE;
+}
+
+uint32_t HeapProfiler::record_allocation(size_t size, size_t bytes, void* caller) {
+    __atomic_fetch_add(&m_histogram[size_class(size)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&m_allocations, 1, __ATOMIC_RELAXED);
+
+    uint64_t live = __atomic_add_fetch(&m_live_bytes, bytes, __ATOMIC_RELAXED);
+    uint64_t peak = __atomic_load_n(&m_peak_bytes, __ATOMIC_RELAXED);
+    while (live > peak && !__atomic_compare_exchange_n(&m_peak_bytes, &peak, live, true,
+                                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+
+    uint32_t site = find_site(caller);
+    if (site != NO_SITE) {
+        __atomic_fetch_add(&m_sites[site].allocations, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&m_sites[site].live_bytes, bytes, __ATOMIC_RELAXED);
+    }
+
+    return site;
+}
+
+void HeapProfiler::record_free(uint32_t site, size_t bytes) {
+    __atomic_fetch_add(&m_frees, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&m_live_bytes, bytes, __ATOMIC_RELAXED);
+
+    if (site >= MAX_SITES) return;
+
+    __atomic_fetch_add(&m_sites[site].frees, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_sub(&m_sites[site].live_bytes, bytes, __ATOMIC_RELAXED);
+}
+
+void HeapProfiler::reset() {
+    for (size_t i = 0; i < SIZE_CLASSES; i++) {
+        __atomic_store_n(&m_histogram[i], 0, __ATOMIC_RELAXED);
+    }
+
+    for (size_t i = 0; i < MAX_SITES; i++) {
+        __atomic_store_n(&m_sites[i].allocations, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&m_sites[i].frees, 0, __ATOMIC_RELAXED);
+    }
+
+    __atomic_store_n(&m_allocations, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&m_frees, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&m_peak_bytes, __atomic_load_n(&m_live_bytes, __ATOMIC_RELAXED),
+                     __ATOMIC_RELAXED);
+    __atomic_store_n(&m_dropped_sites, 0, __ATOMIC_RELAXED);
+    m_start_ticks = get_ticks();
+}
+
+void HeapProfiler::report(putchar_function output_char) {
+    uint64_t elapsed = get_ticks() - m_start_ticks;
+    uint64_t rate = elapsed ? m_allocations * get_timer_frequency() / elapsed : 0;
+
+    printf_to(output_char, "Heap profile (%s)\n", is_enabled() ? "enabled" : "disabled");
+    printf_to(output_char, "Live: %lu bytes, peak %lu bytes\n", m_live_bytes, m_peak_bytes);
+    printf_to(output_char, "Allocations: %lu, frees: %lu, %lu allocs/s\n", m_allocations, m_frees,
+              rate);
+
+    printf_to(output_char, "\nSize class |      Count\n");
+    printf_to(output_char, "-----------+-----------\n");
+    for (size_t i = 0; i < SIZE_CLASSES; i++) {
+        if (!m_histogram[i]) continue;
+        if (i == SIZE_CLASSES - 1)
+            printf_to(output_char, "  >%7lu | %10lu\n", 1UL << (i + 3), m_histogram[i]);
+        else
+            printf_to(output_char, " <=%7lu | %10lu\n", 1UL << (i + 4), m_histogram[i]);
+    }
+
+    bool shown[MAX_SITES] = {};
+
+    printf_to(output_char, "\nCaller             |   Allocs |    Frees |   Live bytes\n");
+    printf_to(output_char, "-------------------+----------+----------+-------------\n");
+    for (size_t rank = 0; rank < TOP_SITES; rank++) {
+        size_t best = MAX_SITES;
+        for (size_t i = 0; i < MAX_SITES; i++) {
+            if (shown[i] || !m_sites[i].caller || !m_sites[i].live_bytes) continue;
+            if (best == MAX_SITES || m_sites[i].live_bytes > m_sites[best].live_bytes) best = i;
+        }
+        if (best == MAX_SITES) break;
+
+        shown[best] = true;
+        const auto& site = m_sites[best];
+        printf_to(output_char, "%-18lx | %8lu | %8lu | %12lu\n",
+                  reinterpret_cast<uintptr_t>(site.caller), site.allocations, site.frees,
+                  site.live_bytes);
+    }
+
+    if (m_dropped_sites)
+        printf_to(output_char, "%lu allocations from untracked call sites\n", m_dropped_sites);
+}
\ No newline at end of file
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "printf.hpp"
+
+struct HeapCallSite {
+    void* caller = nullptr;
+    uint64_t allocations = 0;
+    uint64_t frees = 0;
+    uint64_t live_bytes = 0;
+};
+
+class HeapProfiler {
+public:
+    static constexpr size_t SIZE_CLASSES = 16;
+    static constexpr size_t MAX_SITES = 256;
+    static constexpr uint32_t NO_SITE = 0xFFFFFFFF;
+
+    static HeapProfiler& instance();
+
+    bool is_enabled() const {
+        return __atomic_load_n(&m_enabled, __ATOMIC_RELAXED);
+    }
+    void set_enabled(bool enabled) {
+        __atomic_store_n(&m_enabled, enabled, __ATOMIC_RELAXED);
+    }
+
+    uint32_t record_allocation(size_t size, size_t bytes, void* caller);
+    void record_free(uint32_t site, size_t bytes);
+    void reset();
+    void report(putchar_function output_char);
+
+private:
+    HeapProfiler() = default;
+    ~HeapProfiler() = default;
+
+    HeapProfiler(const HeapProfiler&) = delete;
+    HeapProfiler& operator=(const HeapProfiler&) = delete;
+
+    static size_t size_class(size_t size);
+    uint32_t find_site(void* caller);
+
+    bool m_enabled = false;
+    HeapCallSite m_sites[MAX_SITES];
+    uint64_t m_histogram[SIZE_CLASSES] = {};
+    uint64_t m_allocations = 0;
+    uint64_t m_frees = 0;
+    uint64_t m_live_bytes = 0;
+    uint64_t m_peak_bytes = 0;
+    uint64_t m_dropped_sites = 0;
+    uint64_t m_start_ticks = 0;
+};
\ No newline at end of file
@@ -3,94 +3,654 @@
 #include <cstring>
 
 #include "printf.hpp"
+#include "vga.hpp"
+#include "virtual_memory.hpp"
 
-static uint32_t initial_bitmap[16384];
+extern "C" char __kernel_start[];
+extern "C" char __kernel_end[];
+
+namespace {
+constexpr uint32_t INVALID_FRAME = 0xFFFFFFFF;
+constexpr uintptr_t LOW_MEMORY_LIMIT = 0x100000;
+constexpr size_t MAX_FRAMES = INVALID_FRAME;
+
+void zero_frame_nontemporal(void* frame) {
+    auto* words = phys_to_virt<uint64_t>(reinterpret_cast<uintptr_t>(frame));
+    for (size_t i = 0; i < PhysicalMemoryManager::PAGE_SIZE / sizeof(uint64_t); i += 4) {
+        asm volatile(
+            "movnti %1, (%0)\n"
+            "movnti %1, 8(%0)\n"
+            "movnti %1, 16(%0)\n"
+            "movnti %1, 24(%0)"
+            :
+            : "r"(words + i), "r"(0ULL)
+            : "memory");
+    }
+    asm volatile("sfence" : : : "memory");
+}
+
+void zero_frame(void* frame) {
+    void* dest = phys_to_virt(reinterpret_cast<uintptr_t>(frame));
+    size_t count = PhysicalMemoryManager::PAGE_SIZE / sizeof(uint64_t);
+    asm volatile("rep stosq" : "+D"(dest), "+c"(count) : "a"(0ULL) : "memory");
+}
+}  // namespace
 
 PhysicalMemoryManager& PhysicalMemoryManager::instance() {
     static PhysicalMemoryManager instance;
     return instance;
 }
 
+bool PhysicalMemoryManager::initialize(const kernel::MultibootMemoryMapTag* memory_map) {
+    m_zone_count = 0;
+
+    auto* entries = reinterpret_cast<const uint8_t*>(memory_map + 1);
+    auto* end = reinterpret_cast<const uint8_t*>(memory_map) + memory_map->size;
+
+    for (auto* ptr = entries; memory_map->entry_size && ptr < end;
+         ptr += memory_map->entry_size) {
+        auto* entry = reinterpret_cast<const kernel::MultibootMemoryMapEntry*>(ptr);
+        if (entry->type != kernel::MULTIBOOT_MEMORY_AVAILABLE) continue;
+
+        add_zone(entry->addr, entry->addr + entry->len);
+    }
+
+    return setup();
+}
+
 void PhysicalMemoryManager::initialize(uintptr_t memory_start, size_t memory_size) {
-    m_memory_start = memory_start;
-    m_total_frames = memory_size / PAGE_SIZE;
-    m_free_frames = m_total_frames;
+    m_zone_count = 0;
+    add_zone(memory_start, memory_start + memory_size);
+    setup();
+}
+
+void PhysicalMemoryManager::add_zone(uint64_t start, uint64_t end) {
+    if (start < LOW_MEMORY_LIMIT) start = LOW_MEMORY_LIMIT;
+
+    start = (start + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    end &= ~(PAGE_SIZE - 1);
 
-    m_bitmap = initial_bitmap;
-    size_t bitmap_size = (m_total_frames + 31) / 32 * sizeof(uint32_t);
+    if (end > MAX_FRAMES * PAGE_SIZE) end = MAX_FRAMES * PAGE_SIZE;
+    if (end <= start || m_zone_count >= MAX_ZONES) return;
 
-    memset(m_bitmap, 0, bitmap_size);
+    m_zones[m_zone_count].start = start;
+    m_zones[m_zone_count].size = end - start;
+    m_zone_count++;
+}
+
+uintptr_t PhysicalMemoryManager::place_metadata(size_t size, uintptr_t kernel_start,
+                                                uintptr_t kernel_end, uintptr_t info_start,
+                                                uintptr_t info_end) {
+    for (size_t i = 0; i < m_zone_count; i++) {
+        uintptr_t candidate = m_zones[i].start;
+        uintptr_t zone_end = m_zones[i].start + m_zones[i].size;
+        if (zone_end > BOOT_IDENTITY_LIMIT) zone_end = BOOT_IDENTITY_LIMIT;
 
-    size_t first_mb_frames = 0x100000 / PAGE_SIZE;
-    for (size_t i = 0; i < first_mb_frames; i++) {
-        size_t idx = i / 32;
-        size_t bit = i % 32;
-        m_bitmap[idx] |= (1u << bit);
-        m_free_frames--;
+        while (candidate + size <= zone_end) {
+            if (candidate < kernel_end && candidate + size > kernel_start)
+                candidate = kernel_end;
+            else if (candidate < info_end && candidate + size > info_start)
+                candidate = info_end;
+            else
+                return candidate;
+        }
     }
 
-    size_t heap_start_frame = (memory_size - (16 * 1024 * 1024)) / PAGE_SIZE;
-    size_t heap_frames = (16 * 1024 * 1024) / PAGE_SIZE;
-    for (size_t i = heap_start_frame; i < heap_start_frame + heap_frames; i++) {
-        size_t idx = i / 32;
-        size_t bit = i % 32;
-        m_bitmap[idx] |= (1u << bit);
-        m_free_frames--;
+    return 0;
+}
+
+bool PhysicalMemoryManager::setup() {
+    if (m_zone_count == 0) return false;
+
+    m_memory_start = m_zones[0].start;
+    m_total_frames = 0;
+    m_free_frames = 0;
+    m_frame_limit = 0;
+
+    for (size_t i = 0; i < m_zone_count; i++) {
+        const auto& zone = m_zones[i];
+        if (zone.start < m_memory_start) m_memory_start = zone.start;
+        if ((zone.start + zone.size) / PAGE_SIZE > m_frame_limit)
+            m_frame_limit = (zone.start + zone.size) / PAGE_SIZE;
+        m_total_frames += zone.size / PAGE_SIZE;
     }
 
-    size_t page_table_frames = 5;
-    for (size_t i = first_mb_frames; i < first_mb_frames + page_table_frames; i++) {
-        size_t idx = i / 32;
-        size_t bit = i % 32;
-        m_bitmap[idx] |= (1u << bit);
-        m_free_frames--;
+    for (size_t order = 0; order <= MAX_ORDER; order++) {
+        m_free_lists[order] = INVALID_FRAME;
+        m_free_counts[order] = 0;
     }
 
-    volatile uint16_t* vga = reinterpret_cast<uint16_t*>(0xB8000);
+    uintptr_t kernel_start = reinterpret_cast<uintptr_t>(__kernel_start) & ~(PAGE_SIZE - 1);
+    uintptr_t kernel_end =
+        (reinterpret_cast<uintptr_t>(__kernel_end) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+
+    uintptr_t info_start = kernel::get_multiboot_info_address() & ~(PAGE_SIZE - 1);
+    uintptr_t info_end = (kernel::get_multiboot_info_address() +
+                          kernel::get_multiboot_info_size() + PAGE_SIZE - 1) &
+                         ~(PAGE_SIZE - 1);
+
+    size_t frames_size = (m_frame_limit * sizeof(FrameInfo) + 7) & ~7ULL;
+    size_t bitmap_size = kernel::SummaryBitmap::storage_words(m_frame_limit) * sizeof(uint64_t);
+    size_t metadata_size = (frames_size + bitmap_size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    uintptr_t metadata =
+        place_metadata(metadata_size, kernel_start, kernel_end, info_start, info_end);
+
+    if (!metadata) {
+        volatile uint16_t* vga = vga_memory();
+        const char* msg = "ERROR: No room for PMM metadata";
+        for (int i = 0; msg[i] != '\0'; i++) {
+            vga[i + 320] = 0x0C00 | msg[i];
+        }
+        m_zone_count = 0;
+        return false;
+    }
+
+    m_frames = reinterpret_cast<FrameInfo*>(metadata);
+    m_free_heads.initialize(reinterpret_cast<uint64_t*>(metadata + frames_size), m_frame_limit);
+    m_free_orders = 0;
+
+    for (size_t i = 0; i < m_frame_limit; i++) {
+        m_frames[i] = FrameInfo{};
+    }
+
+    for (size_t i = 0; i < m_zone_count; i++) {
+        size_t first = m_zones[i].start / PAGE_SIZE;
+        size_t last = first + m_zones[i].size / PAGE_SIZE;
+        for (size_t pfn = first; pfn < last; pfn++) {
+            m_frames[pfn].state = FrameState::Tail;
+        }
+    }
+
+    reserve_range(kernel_start / PAGE_SIZE, (kernel_end - kernel_start) / PAGE_SIZE);
+    reserve_range(info_start / PAGE_SIZE, (info_end - info_start) / PAGE_SIZE);
+    reserve_range(metadata / PAGE_SIZE, metadata_size / PAGE_SIZE);
+
+    size_t end = m_frame_limit;
+    while (end > 0) {
+        if (m_frames[end - 1].state != FrameState::Tail) {
+            end--;
+            continue;
+        }
+
+        size_t order = 0;
+        while (order < MAX_ORDER) {
+            size_t size = 1ULL << (order + 1);
+            if (end < size) break;
+
+            size_t start = end - size;
+            if ((start & (size - 1)) != 0) break;
+
+            bool usable = true;
+            for (size_t i = start; i < end - (1ULL << order); i++) {
+                if (m_frames[i].state != FrameState::Tail) {
+                    usable = false;
+                    break;
+                }
+            }
+            if (!usable) break;
+
+            order++;
+        }
+
+        end -= 1ULL << order;
+        m_free_frames += 1ULL << order;
+        free_block(end, order);
+    }
+
+    volatile uint16_t* vga = vga_memory();
     const char* msg = "[5] PMM Init Done";
     for (int i = 0; msg[i] != '\0'; i++) {
         vga[i + 320] = 0x0F00 | msg[i];
     }
+
+    return true;
+}
+
+void PhysicalMemoryManager::relocate_metadata() {
+    kernel::ScopedLock guard(m_lock);
+
+    m_frames = phys_to_virt<FrameInfo>(virt_to_phys(m_frames));
+    m_free_heads.relocate(phys_to_virt<uint64_t>(virt_to_phys(m_free_heads.storage())));
+}
+
+void PhysicalMemoryManager::reserve_region(uintptr_t start, size_t size) {
+    kernel::ScopedLock guard(m_lock);
+
+    size_t first = start / PAGE_SIZE;
+    size_t last = (start + size + PAGE_SIZE - 1) / PAGE_SIZE;
+
+    for (size_t pfn = first; pfn < last && pfn < m_frame_limit; pfn++) {
+        carve_frame(pfn);
+    }
+}
+
+void PhysicalMemoryManager::carve_frame(size_t pfn) {
+    size_t head = pfn;
+    size_t order = 0;
+
+    while (order <= MAX_ORDER) {
+        head = pfn & ~((1ULL << order) - 1);
+        if (m_frames[head].state == FrameState::Free && m_frames[head].order == order) break;
+        order++;
+    }
+
+    if (order > MAX_ORDER) return;
+
+    remove_free(head, order);
+
+    while (order > 0) {
+        order--;
+        size_t half = 1ULL << order;
+
+        if (pfn < head + half)
+            push_free(head + half, order);
+        else {
+            push_free(head, order);
+            head += half;
+        }
+    }
+
+    m_frames[pfn].state = FrameState::Reserved;
+    m_free_frames--;
+}
+
+void PhysicalMemoryManager::reserve_range(size_t first_frame, size_t count) {
+    for (size_t i = first_frame; i < first_frame + count && i < m_frame_limit; i++) {
+        m_frames[i].state = FrameState::Reserved;
+    }
+}
+
+void PhysicalMemoryManager::push_free(size_t pfn, size_t order) {
+    FrameInfo& info = m_frames[pfn];
+    info.state = FrameState::Free;
+    info.order = order;
+    info.prev = INVALID_FRAME;
+    info.next = m_free_lists[order];
+
+    if (info.next != INVALID_FRAME) m_frames[info.next].prev = pfn;
+
+    m_free_lists[order] = pfn;
+    m_free_counts[order]++;
+    m_free_orders |= 1U << order;
+    m_free_heads.set(pfn);
+}
+
+void PhysicalMemoryManager::remove_free(size_t pfn, size_t order) {
+    FrameInfo& info = m_frames[pfn];
+
+    if (info.prev != INVALID_FRAME)
+        m_frames[info.prev].next = info.next;
+    else
+        m_free_lists[order] = info.next;
+
+    if (info.next != INVALID_FRAME) m_frames[info.next].prev = info.prev;
+
+    info.state = FrameState::Tail;
+    info.next = INVALID_FRAME;
+    info.prev = INVALID_FRAME;
+    m_free_counts[order]--;
+    m_free_heads.clear(pfn);
+    if (m_free_lists[order] == INVALID_FRAME) m_free_orders &= ~(1U << order);
+}
+
+void PhysicalMemoryManager::free_block(size_t pfn, size_t order) {
+    m_frames[pfn].state = FrameState::Tail;
+
+    while (order < MAX_ORDER) {
+        size_t buddy = pfn ^ (1ULL << order);
+        if (buddy >= m_frame_limit) break;
+
+        FrameInfo& info = m_frames[buddy];
+        if (info.state != FrameState::Free || info.order != order) break;
+
+        remove_free(buddy, order);
+
+        if (buddy < pfn) pfn = buddy;
+        order++;
+    }
+
+    push_free(pfn, order);
+}
+
+void* PhysicalMemoryManager::take_block(size_t order) {
+    if (m_free_frames < (1ULL << order)) return nullptr;
+
+    uint32_t orders = m_free_orders >> order;
+
+    if (!orders) {
+        volatile uint16_t* vga = vga_memory();
+        const char* msg = "ERROR: No free frames available";
+        for (int i = 0; msg[i] != '\0'; i++) {
+            vga[i + (27 * 80)] = 0x0C00 | msg[i];
+        }
+        return nullptr;
+    }
+
+    size_t current = order + __builtin_ctz(orders);
+    return split_block(m_free_lists[current], current, order);
+}
+
+void* PhysicalMemoryManager::split_block(size_t pfn, size_t current, size_t order) {
+    remove_free(pfn, current);
+
+    while (current > order) {
+        current--;
+        push_free(pfn + (1ULL << current), current);
+    }
+
+    m_frames[pfn].state = FrameState::Allocated;
+    m_frames[pfn].order = order;
+    m_free_frames -= 1ULL << order;
+
+    return reinterpret_cast<void*>(pfn * PAGE_SIZE);
+}
+
+bool PhysicalMemoryManager::release_block(uintptr_t addr, size_t order) {
+    if (addr < m_memory_start || order > MAX_ORDER) return false;
+
+    size_t pfn = addr / PAGE_SIZE;
+    if (pfn >= m_frame_limit) return false;
+
+    FrameInfo& info = m_frames[pfn];
+    if (info.state != FrameState::Allocated || info.order != order) return false;
+
+    m_free_frames += 1ULL << order;
+    free_block(pfn, order);
+    return true;
+}
+
+FrameCache* PhysicalMemoryManager::current_cache() {
+    uint32_t cpu_id = kernel::SMPManager::instance().get_current_cpu_id();
+    if (cpu_id >= kernel::MAX_CPUS) return nullptr;
+
+    return &m_caches[cpu_id];
+}
+
+void PhysicalMemoryManager::refill_cache(FrameCache* cache) {
+    kernel::ScopedLock guard(m_lock);
+
+    while (cache->count < FrameCache::BATCH) {
+        void* frame = take_block(0);
+        if (!frame) break;
+        set_frame_state(frame, FrameState::Cached);
+        cache->frames[cache->count++] = frame;
+    }
+
+    cache->stats.refills++;
+}
+
+void PhysicalMemoryManager::drain_cache(FrameCache* cache, size_t count) {
+    kernel::ScopedLock guard(m_lock);
+
+    while (count-- > 0 && cache->count > 0) {
+        void* frame = cache->frames[--cache->count];
+        set_frame_state(frame, FrameState::Allocated);
+        release_block(reinterpret_cast<uintptr_t>(frame), 0);
+    }
+
+    cache->stats.drains++;
+}
+
+void* PhysicalMemoryManager::allocate_frames(size_t order) {
+    if (order == 0) return allocate_frame();
+    if (order > MAX_ORDER) return nullptr;
+
+    kernel::ScopedLock guard(m_lock);
+    return take_block(order);
+}
+
+void PhysicalMemoryManager::free_frames(void* frames, size_t order) {
+    if (order == 0) {
+        free_frame(frames);
+        return;
+    }
+
+    kernel::ScopedLock guard(m_lock);
+    release_block(reinterpret_cast<uintptr_t>(frames), order);
+}
+
+void* PhysicalMemoryManager::allocate_contiguous(size_t count, size_t alignment,
+                                                 uintptr_t max_phys_addr) {
+    if (count == 0 || (alignment & (alignment - 1)) != 0) return nullptr;
+    if (alignment < PAGE_SIZE) alignment = PAGE_SIZE;
+
+    size_t limit_pfn = max_phys_addr / PAGE_SIZE;
+    if (max_phys_addr != UINTPTR_MAX) limit_pfn = (max_phys_addr + 1) / PAGE_SIZE;
+    if (limit_pfn > m_frame_limit) limit_pfn = m_frame_limit;
+
+    kernel::ScopedLock guard(m_lock);
+
+    if (m_free_frames < count) return nullptr;
+
+    size_t pfn = find_contiguous(count, alignment / PAGE_SIZE, limit_pfn);
+    if (pfn == kernel::SummaryBitmap::NOT_FOUND) return nullptr;
+
+    claim_range(pfn, count);
+    return reinterpret_cast<void*>(pfn * PAGE_SIZE);
+}
+
+void PhysicalMemoryManager::free_contiguous(void* frames, size_t count) {
+    uintptr_t addr = reinterpret_cast<uintptr_t>(frames);
+    if (addr % PAGE_SIZE != 0) return;
+
+    kernel::ScopedLock guard(m_lock);
+
+    for (size_t i = 0; i < count; i++) {
+        release_block(addr + i * PAGE_SIZE, 0);
+    }
+}
+
+size_t PhysicalMemoryManager::find_contiguous(size_t count, size_t align_frames,
+                                              size_t limit_pfn) {
+    size_t order = 0;
+    while ((1ULL << order) < count || (1ULL << order) < align_frames)
+        order++;
+
+    if (order <= MAX_ORDER) {
+        if (!(m_free_orders >> order)) return kernel::SummaryBitmap::NOT_FOUND;
+
+        for (size_t pfn = m_free_heads.find_first(0);
+             pfn != kernel::SummaryBitmap::NOT_FOUND && pfn + count <= limit_pfn;
+             pfn = m_free_heads.find_first(pfn + 1)) {
+            if (m_frames[pfn].order >= order) return pfn;
+        }
+
+        return kernel::SummaryBitmap::NOT_FOUND;
+    }
+
+    constexpr size_t BLOCK = 1ULL << MAX_ORDER;
+    size_t blocks = (count + BLOCK - 1) / BLOCK;
+    size_t run_start = 0;
+    size_t run_length = 0;
+
+    for (size_t pfn = m_free_heads.find_first(0);
+         pfn != kernel::SummaryBitmap::NOT_FOUND && pfn < limit_pfn;
+         pfn = m_free_heads.find_first(pfn + 1)) {
+        if (m_frames[pfn].order != MAX_ORDER) continue;
+
+        if (run_length && pfn == run_start + run_length * BLOCK) {
+            run_length++;
+        } else if (pfn % align_frames == 0) {
+            run_start = pfn;
+            run_length = 1;
+        } else {
+            run_length = 0;
+        }
+
+        if (run_length == blocks)
+            return run_start + count <= limit_pfn ? run_start : kernel::SummaryBitmap::NOT_FOUND;
+    }
+
+    return kernel::SummaryBitmap::NOT_FOUND;
+}
+
+void PhysicalMemoryManager::claim_range(size_t pfn, size_t count) {
+    size_t end = pfn;
+    while (end < pfn + count) {
+        size_t order = m_frames[end].order;
+        remove_free(end, order);
+        end += 1ULL << order;
+    }
+
+    for (size_t i = pfn; i < pfn + count; i++) {
+        m_frames[i].state = FrameState::Allocated;
+        m_frames[i].order = 0;
+    }
+
+    m_free_frames -= count;
+
+    for (size_t tail = pfn + count; tail < end;) {
+        size_t order = 0;
+        while (order < MAX_ORDER && tail % (2ULL << order) == 0 && tail + (2ULL << order) <= end)
+            order++;
+
+        free_block(tail, order);
+        tail += 1ULL << order;
+    }
 }
 
 void* PhysicalMemoryManager::allocate_frame() {
-    if (m_free_frames == 0) return nullptr;
+    FrameCache* cache = current_cache();
+    if (!cache) {
+        kernel::ScopedLock guard(m_lock);
+        return take_block(0);
+    }
+
+    uint64_t flags = kernel::Spinlock::save_irq();
+
+    if (cache->count == 0) {
+        cache->stats.misses++;
+        refill_cache(cache);
+    } else
+        cache->stats.hits++;
+
+    void* frame = cache->count > 0 ? cache->frames[--cache->count] : nullptr;
+    if (frame) set_frame_state(frame, FrameState::Allocated);
+
+    kernel::Spinlock::restore_irq(flags);
+    return frame ? frame : take_zeroed();
+}
+
+void* PhysicalMemoryManager::allocate_zeroed_frame() {
+    void* frame = take_zeroed();
+    if (frame) {
+        __atomic_fetch_add(&m_zero_stats.pool_hits, 1, __ATOMIC_RELAXED);
+        return frame;
+    }
+
+    frame = allocate_frame();
+    if (!frame) return nullptr;
+
+    zero_frame(frame);
+    __atomic_fetch_add(&m_zero_stats.zeroed_on_demand, 1, __ATOMIC_RELAXED);
+    return frame;
+}
+
+size_t PhysicalMemoryManager::refill_zero_pool() {
+    size_t added = 0;
+
+    while (added < ZERO_POOL_BATCH && m_zero_count < ZERO_POOL_CAPACITY &&
+           m_free_frames > ZERO_POOL_CAPACITY) {
+        void* frame = allocate_frame();
+        if (!frame) break;
 
-    for (size_t i = 0; i < m_total_frames; i++) {
-        size_t idx = i / 32;
-        size_t bit = i % 32;
+        zero_frame_nontemporal(frame);
 
-        if ((m_bitmap[idx] & (1u << bit)) == 0) {
-            m_bitmap[idx] |= (1u << bit);
-            m_free_frames--;
-            return reinterpret_cast<void*>(m_memory_start + i * PAGE_SIZE);
+        uint64_t flags = m_zero_lock.lock_irqsave();
+        bool stored = m_zero_count < ZERO_POOL_CAPACITY;
+        if (stored) {
+            set_frame_state(frame, FrameState::Cached);
+            m_zero_pool[m_zero_count++] = frame;
+            m_zero_stats.prezeroed++;
         }
+        m_zero_lock.unlock_irqrestore(flags);
+
+        if (!stored) {
+            free_frame(frame);
+            break;
+        }
+        added++;
     }
 
-    volatile uint16_t* vga = reinterpret_cast<uint16_t*>(0xB8000);
-    const char* msg = "ERROR: No free frames available";
-    for (int i = 0; msg[i] != '\0'; i++) {
-        vga[i + (27 * 80)] = 0x0C00 | msg[i];
+    return added;
+}
+
+void* PhysicalMemoryManager::take_zeroed() {
+    kernel::ScopedLock guard(m_zero_lock);
+    if (m_zero_count == 0) return nullptr;
+
+    void* frame = m_zero_pool[--m_zero_count];
+    set_frame_state(frame, FrameState::Allocated);
+    return frame;
+}
+
+void* PhysicalMemoryManager::allocate_frame_below(uintptr_t limit) {
+    kernel::ScopedLock guard(m_lock);
+
+    size_t limit_pfn = limit / PAGE_SIZE;
+    size_t pfn = m_free_heads.find_next();
+
+    if (pfn != kernel::SummaryBitmap::NOT_FOUND && pfn >= limit_pfn) {
+        m_free_heads.reset_cursor();
+        pfn = m_free_heads.find_next();
     }
-    return nullptr;
+
+    if (pfn == kernel::SummaryBitmap::NOT_FOUND || pfn >= limit_pfn) return nullptr;
+
+    return split_block(pfn, m_frames[pfn].order, 0);
 }
 
 void PhysicalMemoryManager::free_frame(void* frame) {
     uintptr_t addr = reinterpret_cast<uintptr_t>(frame);
     if (addr < m_memory_start) return;
 
-    size_t frame_index = (addr - m_memory_start) / PAGE_SIZE;
-    if (frame_index >= m_total_frames) return;
+    size_t pfn = addr / PAGE_SIZE;
+    if (pfn >= m_frame_limit) return;
 
-    size_t idx = frame_index / 32;
-    size_t bit = frame_index % 32;
+    FrameInfo& info = m_frames[pfn];
+    if (info.state != FrameState::Allocated || info.order != 0) return;
 
-    if (m_bitmap[idx] & (1u << bit)) {
-        m_bitmap[idx] &= ~(1u << bit);
-        m_free_frames++;
+    uint16_t shares = __atomic_load_n(&info.shares, __ATOMIC_ACQUIRE);
+    while (shares) {
+        if (__atomic_compare_exchange_n(&info.shares, &shares, shares - 1, false, __ATOMIC_ACQ_REL,
+                                        __ATOMIC_ACQUIRE))
+            return;
     }
+
+    FrameCache* cache = current_cache();
+    if (!cache) {
+        kernel::ScopedLock guard(m_lock);
+        release_block(addr, 0);
+        return;
+    }
+
+    uint64_t flags = kernel::Spinlock::save_irq();
+
+    if (cache->count == FrameCache::CAPACITY) drain_cache(cache, FrameCache::BATCH);
+    info.state = FrameState::Cached;
+    cache->frames[cache->count++] = reinterpret_cast<void*>(addr & ~(PAGE_SIZE - 1));
+
+    kernel::Spinlock::restore_irq(flags);
+}
+
+void PhysicalMemoryManager::share_frame(void* frame) {
+    size_t pfn = reinterpret_cast<uintptr_t>(frame) / PAGE_SIZE;
+    if (pfn >= m_frame_limit || m_frames[pfn].state != FrameState::Allocated) return;
+
+    __atomic_fetch_add(&m_frames[pfn].shares, 1, __ATOMIC_RELAXED);
+}
+
+size_t PhysicalMemoryManager::get_frame_refs(void* frame) const {
+    size_t pfn = reinterpret_cast<uintptr_t>(frame) / PAGE_SIZE;
+    if (pfn >= m_frame_limit || m_frames[pfn].state != FrameState::Allocated) return 0;
+
+    return __atomic_load_n(&m_frames[pfn].shares, __ATOMIC_ACQUIRE) + 1;
 }
 
 size_t PhysicalMemoryManager::get_free_frames() const {
-    return m_free_frames;
+    size_t free_frames = m_free_frames + m_zero_count;
+    for (size_t i = 0; i < kernel::MAX_CPUS; i++) {
+        free_frames += m_caches[i].count;
+    }
+    return free_frames;
 }
\ No newline at end of file
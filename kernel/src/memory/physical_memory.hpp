@@ -3,19 +3,109 @@
 #include <cstddef>
 #include <cstdint>
 
+#include "core/multiboot2.hpp"
+#include "hw/smp.hpp"
+#include "lib/bitmap.hpp"
+#include "lib/spinlock.hpp"
+
+enum class FrameState : uint8_t {
+    Reserved,
+    Free,
+    Allocated,
+    Cached,
+    Tail,
+};
+
+struct FrameInfo {
+    uint32_t next = 0;
+    uint32_t prev = 0;
+    uint8_t order = 0;
+    FrameState state = FrameState::Reserved;
+    uint16_t shares = 0;
+};
+
+struct MemoryZone {
+    uintptr_t start = 0;
+    size_t size = 0;
+};
+
+struct FrameCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t refills = 0;
+    uint64_t drains = 0;
+};
+
+struct ZeroPoolStats {
+    uint64_t pool_hits = 0;
+    uint64_t zeroed_on_demand = 0;
+    uint64_t prezeroed = 0;
+};
+
+struct alignas(64) FrameCache {
+    static constexpr size_t CAPACITY = 64;
+    static constexpr size_t BATCH = 32;
+
+    size_t count = 0;
+    FrameCacheStats stats;
+    void* frames[CAPACITY] = {};
+};
+
 class PhysicalMemoryManager {
 public:
     static constexpr size_t PAGE_SIZE = 4096;
+    static constexpr size_t MAX_ORDER = 10;
+    static constexpr size_t MAX_ZONES = 16;
+    static constexpr uintptr_t BOOT_IDENTITY_LIMIT = 0x40000000;
+    static constexpr size_t ZERO_POOL_CAPACITY = 256;
+    static constexpr size_t ZERO_POOL_BATCH = 16;
 
     static PhysicalMemoryManager& instance();
 
+    bool initialize(const kernel::MultibootMemoryMapTag* memory_map);
     void initialize(uintptr_t memory_start, size_t memory_size);
+    void reserve_region(uintptr_t start, size_t size);
+    void relocate_metadata();
     void* allocate_frame();
+    void* allocate_frame_below(uintptr_t limit);
+    void* allocate_zeroed_frame();
+    size_t refill_zero_pool();
     void free_frame(void* frame);
+    void share_frame(void* frame);
+    size_t get_frame_refs(void* frame) const;
+    void* allocate_frames(size_t order);
+    void free_frames(void* frames, size_t order);
+    void* allocate_contiguous(size_t count, size_t alignment = PAGE_SIZE,
+                              uintptr_t max_phys_addr = UINTPTR_MAX);
+    void free_contiguous(void* frames, size_t count);
     size_t get_free_frames() const;
     size_t get_total_frames() const {
         return m_total_frames;
     }
+    uintptr_t get_memory_end() const {
+        return m_frame_limit * PAGE_SIZE;
+    }
+    size_t get_zone_count() const {
+        return m_zone_count;
+    }
+    const MemoryZone& get_zone(size_t index) const {
+        return m_zones[index < m_zone_count ? index : 0];
+    }
+    size_t get_free_blocks(size_t order) const {
+        return order <= MAX_ORDER ? m_free_counts[order] : 0;
+    }
+    size_t get_cached_frames(uint32_t cpu_id) const {
+        return cpu_id < kernel::MAX_CPUS ? m_caches[cpu_id].count : 0;
+    }
+    const FrameCacheStats& get_cache_stats(uint32_t cpu_id) const {
+        return m_caches[cpu_id < kernel::MAX_CPUS ? cpu_id : 0].stats;
+    }
+    size_t get_zeroed_frames() const {
+        return m_zero_count;
+    }
+    const ZeroPoolStats& get_zero_pool_stats() const {
+        return m_zero_stats;
+    }
 
 private:
     PhysicalMemoryManager() = default;
@@ -24,7 +114,45 @@ private:
     PhysicalMemoryManager(const PhysicalMemoryManager&) = delete;
     PhysicalMemoryManager& operator=(const PhysicalMemoryManager&) = delete;
 
-    uint32_t* m_bitmap = nullptr;
+    void add_zone(uint64_t start, uint64_t end);
+    bool setup();
+    uintptr_t place_metadata(size_t size, uintptr_t kernel_start, uintptr_t kernel_end,
+                             uintptr_t info_start, uintptr_t info_end);
+    void reserve_range(size_t first_frame, size_t count);
+    void carve_frame(size_t pfn);
+    void* split_block(size_t pfn, size_t current, size_t order);
+    size_t find_contiguous(size_t count, size_t align_frames, size_t limit_pfn);
+    void claim_range(size_t pfn, size_t count);
+    void push_free(size_t pfn, size_t order);
+    void remove_free(size_t pfn, size_t order);
+    void free_block(size_t pfn, size_t order);
+    void* take_block(size_t order);
+    bool release_block(uintptr_t addr, size_t order);
+    FrameCache* current_cache();
+    void refill_cache(FrameCache* cache);
+    void drain_cache(FrameCache* cache, size_t count);
+    void* take_zeroed();
+    void set_frame_state(void* frame, FrameState state) {
+        m_frames[reinterpret_cast<uintptr_t>(frame) / PAGE_SIZE].state = state;
+    }
+
+    FrameCache m_caches[kernel::MAX_CPUS];
+    kernel::Spinlock m_lock;
+
+    void* m_zero_pool[ZERO_POOL_CAPACITY] = {};
+    size_t m_zero_count = 0;
+    ZeroPoolStats m_zero_stats;
+    kernel::Spinlock m_zero_lock;
+
+    MemoryZone m_zones[MAX_ZONES];
+    size_t m_zone_count = 0;
+
+    FrameInfo* m_frames = nullptr;
+    kernel::SummaryBitmap m_free_heads;
+    uint32_t m_free_orders = 0;
+    uint32_t m_free_lists[MAX_ORDER + 1] = {};
+    size_t m_free_counts[MAX_ORDER + 1] = {};
+    size_t m_frame_limit = 0;
     size_t m_total_frames = 0;
     size_t m_free_frames = 0;
     uintptr_t m_memory_start = 0;
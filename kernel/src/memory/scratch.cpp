@@ -0,0 +1,113 @@
+#include "scratch.hpp"
+
+#include <cstring>
+
+#include "hw/smp.hpp"
+#include "physical_memory.hpp"
+#include "virtual_memory.hpp"
+
+namespace {
+ScratchArena arenas[kernel::MAX_CPUS];
+
+size_t align_up(size_t value, size_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+}  // namespace
+
+static_assert(ScratchArena::BLOCK_SIZE == PhysicalMemoryManager::PAGE_SIZE
+                                              << ScratchArena::BLOCK_ORDER);
+
+ScratchArena& ScratchArena::current() {
+    uint32_t cpu_id = kernel::SMPManager::instance().get_current_cpu_id();
+    return arenas[cpu_id < kernel::MAX_CPUS ? cpu_id : 0];
+}
+
+void* ScratchArena::allocate(size_t size, size_t align) {
+    if (size == 0 || align == 0 || (align & (align - 1)) != 0 ||
+        align > PhysicalMemoryManager::PAGE_SIZE)
+        return nullptr;
+
+    if (size > LARGE_THRESHOLD) return allocate_large(size);
+
+    size_t offset = align_up(m_offset, align);
+    if (!m_current || offset + size > BLOCK_SIZE) {
+        if (!grow()) return nullptr;
+        offset = align_up(sizeof(ScratchBlock), align);
+    }
+
+    m_offset = offset + size;
+    return reinterpret_cast<uint8_t*>(m_current) + offset;
+}
+
+void* ScratchArena::allocate_zeroed(size_t size) {
+    void* ptr = allocate(size);
+    if (ptr) memset(ptr, 0, size);
+    return ptr;
+}
+
+bool ScratchArena::grow() {
+    ScratchBlock* block = m_spare;
+    if (block) {
+        m_spare = block->prev;
+        m_spare_count--;
+    } else {
+        void* frames = PhysicalMemoryManager::instance().allocate_frames(BLOCK_ORDER);
+        if (!frames) return false;
+
+        block = phys_to_virt<ScratchBlock>(reinterpret_cast<uintptr_t>(frames));
+        block->order = BLOCK_ORDER;
+    }
+
+    block->prev = m_current;
+    m_current = block;
+    m_offset = sizeof(ScratchBlock);
+    return true;
+}
+
+void* ScratchArena::allocate_large(size_t size) {
+    size_t order = 0;
+    while ((PhysicalMemoryManager::PAGE_SIZE << order) < size + sizeof(ScratchBlock)) {
+        if (++order > PhysicalMemoryManager::MAX_ORDER) return nullptr;
+    }
+
+    void* frames = PhysicalMemoryManager::instance().allocate_frames(order);
+    if (!frames) return nullptr;
+
+    auto* block = phys_to_virt<ScratchBlock>(reinterpret_cast<uintptr_t>(frames));
+
+    block->order = order;
+    block->prev = m_large;
+    m_large = block;
+
+    return block + 1;
+}
+
+void ScratchArena::retire(ScratchBlock* block) {
+    if (m_spare_count >= MAX_SPARE_BLOCKS) {
+        PhysicalMemoryManager::instance().free_frames(
+            reinterpret_cast<void*>(virt_to_phys(block)), block->order);
+        return;
+    }
+
+    block->prev = m_spare;
+    m_spare = block;
+    m_spare_count++;
+}
+
+void ScratchArena::release(const ScratchMark& mark) {
+    auto& pmm = PhysicalMemoryManager::instance();
+
+    while (m_large && m_large != mark.large) {
+        ScratchBlock* block = m_large;
+        m_large = block->prev;
+        pmm.free_frames(reinterpret_cast<void*>(virt_to_phys(block)), block->order);
+    }
+
+    while (m_current && m_current != mark.block) {
+        ScratchBlock* block = m_current;
+        m_current = block->prev;
+        retire(block);
+    }
+
+    m_offset = mark.offset;
+}
\ No newline at end of file
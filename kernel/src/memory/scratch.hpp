@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+struct ScratchBlock {
+    ScratchBlock* prev = nullptr;
+    size_t order = 0;
+};
+
+struct ScratchMark {
+    ScratchBlock* block = nullptr;
+    size_t offset = 0;
+    ScratchBlock* large = nullptr;
+};
+
+class ScratchArena {
+public:
+    static constexpr size_t BLOCK_ORDER = 4;
+    static constexpr size_t BLOCK_SIZE = 4096ULL << BLOCK_ORDER;
+    static constexpr size_t LARGE_THRESHOLD = BLOCK_SIZE / 4;
+    static constexpr size_t MAX_SPARE_BLOCKS = 2;
+
+    static ScratchArena& current();
+
+    void* allocate(size_t size, size_t align = 16);
+    void* allocate_zeroed(size_t size);
+
+    ScratchMark mark() const {
+        return {m_current, m_offset, m_large};
+    }
+    void release(const ScratchMark& mark);
+
+private:
+    bool grow();
+    void* allocate_large(size_t size);
+    void retire(ScratchBlock* block);
+
+    ScratchBlock* m_current = nullptr;
+    ScratchBlock* m_large = nullptr;
+    ScratchBlock* m_spare = nullptr;
+    size_t m_offset = 0;
+    size_t m_spare_count = 0;
+};
+
+class ScratchScope {
+public:
+    ScratchScope() : m_arena(ScratchArena::current()), m_mark(m_arena.mark()) {}
+    ~ScratchScope() {
+        m_arena.release(m_mark);
+    }
+
+    ScratchScope(const ScratchScope&) = delete;
+    ScratchScope& operator=(const ScratchScope&) = delete;
+
+    void* allocate(size_t size, size_t align = 16) {
+        return m_arena.allocate(size, align);
+    }
+    void* allocate_zeroed(size_t size) {
+        return m_arena.allocate_zeroed(size);
+    }
+
+private:
+    ScratchArena& m_arena;
+    ScratchMark m_mark;
+};
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include "slab.hpp"
+
+#include "physical_memory.hpp"
+#include "virtual_memory.hpp"
+
+namespace {
+size_t align_up(size_t value, size_t align) {
+    return (value + align - 1) & ~(align - 1);
+}
+}  // namespace
+
+SlabAllocator& SlabAllocator::instance() {
+    static SlabAllocator instance;
+    return instance;
+}
+
+SlabCache* SlabAllocator::create_cache(const char* name, size_t size, size_t align,
+                                       SlabCache::Constructor ctor) {
+    if (size == 0 || (align & (align - 1)) != 0) return nullptr;
+
+    kernel::ScopedLock guard(m_lock);
+
+    if (m_cache_count >= MAX_CACHES) return nullptr;
+
+    SlabCache* cache = &m_caches[m_cache_count];
+    cache->initialize(name, size, align < 8 ? 8 : align, ctor);
+    if (cache->m_objects_per_slab == 0) return nullptr;
+
+    m_cache_count++;
+    return cache;
+}
+
+void SlabCache::initialize(const char* name, size_t size, size_t align, Constructor ctor) {
+    m_name = name;
+    m_object_size = size;
+    m_align = align;
+    m_stride = align_up(size, align);
+    m_ctor = ctor;
+    m_objects_per_slab = 0;
+
+    for (m_order = 0; m_order <= MAX_SLAB_ORDER; m_order++) {
+        size_t slab_bytes = PhysicalMemoryManager::PAGE_SIZE << m_order;
+
+        size_t objects = (slab_bytes - sizeof(Slab)) / (m_stride + sizeof(uint16_t));
+        while (objects > 0 && header_size(objects) + objects * m_stride > slab_bytes)
+            objects--;
+
+        m_objects_per_slab = objects;
+        if (objects >= MIN_OBJECTS_PER_SLAB || m_order == MAX_SLAB_ORDER) break;
+    }
+
+    if (m_objects_per_slab == 0) return;
+
+    size_t slab_bytes = PhysicalMemoryManager::PAGE_SIZE << m_order;
+    size_t leftover =
+        slab_bytes - header_size(m_objects_per_slab) - m_objects_per_slab * m_stride;
+    size_t step = m_align > COLOUR_STEP ? m_align : COLOUR_STEP;
+    m_colours = leftover / step + 1;
+}
+
+size_t SlabCache::header_size(size_t objects) const {
+    return align_up(sizeof(Slab) + objects * sizeof(uint16_t), m_align);
+}
+
+Slab* SlabCache::grow() {
+    auto& pmm = PhysicalMemoryManager::instance();
+    void* frames = pmm.allocate_frames(m_order);
+    if (!frames) return nullptr;
+
+    auto* slab = phys_to_virt<Slab>(reinterpret_cast<uintptr_t>(frames));
+
+    size_t step = m_align > COLOUR_STEP ? m_align : COLOUR_STEP;
+    size_t colour = (m_next_colour++ % m_colours) * step;
+
+    slab->cache = this;
+    slab->next = nullptr;
+    slab->prev = nullptr;
+    slab->objects = reinterpret_cast<uint8_t*>(slab) + header_size(m_objects_per_slab) + colour;
+    slab->in_use = 0;
+    slab->free_top = m_objects_per_slab;
+
+    uint16_t* indices = slab->free_indices();
+    for (size_t i = 0; i < m_objects_per_slab; i++) {
+        indices[i] = m_objects_per_slab - 1 - i;
+        if (m_ctor) m_ctor(slab->objects + i * m_stride);
+    }
+
+    m_slab_count++;
+    return slab;
+}
+
+void SlabCache::release(Slab* slab) {
+    m_slab_count--;
+    PhysicalMemoryManager::instance().free_frames(reinterpret_cast<void*>(virt_to_phys(slab)),
+                                                  m_order);
+}
+
+void* SlabCache::allocate() {
+    kernel::ScopedLock guard(m_lock);
+
+    Slab* slab = m_partial;
+    if (!slab && m_empty) {
+        slab = m_empty;
+        unlink(&m_empty, slab);
+        m_empty_count--;
+        push(&m_partial, slab);
+    }
+    if (!slab) {
+        slab = grow();
+        if (!slab) return nullptr;
+        push(&m_partial, slab);
+    }
+
+    uint16_t index = slab->free_indices()[--slab->free_top];
+    slab->in_use++;
+    m_active_objects++;
+
+    if (slab->free_top == 0) {
+        unlink(&m_partial, slab);
+        push(&m_full, slab);
+    }
+
+    return slab->objects + index * m_stride;
+}
+
+void SlabCache::free(void* object) {
+    if (!object) return;
+
+    size_t slab_bytes = PhysicalMemoryManager::PAGE_SIZE << m_order;
+    auto* slab = reinterpret_cast<Slab*>(reinterpret_cast<uintptr_t>(object) & ~(slab_bytes - 1));
+    if (slab->cache != this) return;
+
+    size_t offset = static_cast<uint8_t*>(object) - slab->objects;
+    if (offset % m_stride != 0 || offset / m_stride >= m_objects_per_slab) return;
+
+    kernel::ScopedLock guard(m_lock);
+
+    if (slab->free_top == 0) {
+        unlink(&m_full, slab);
+        push(&m_partial, slab);
+    }
+
+    slab->free_indices()[slab->free_top++] = offset / m_stride;
+    slab->in_use--;
+    m_active_objects--;
+
+    if (slab->in_use == 0) {
+        unlink(&m_partial, slab);
+        if (m_empty_count == 0) {
+            push(&m_empty, slab);
+            m_empty_count++;
+        } else
+            release(slab);
+    }
+}
+
+void SlabCache::push(Slab** list, Slab* slab) {
+    slab->prev = nullptr;
+    slab->next = *list;
+    if (*list) (*list)->prev = slab;
+    *list = slab;
+}
+
+void SlabCache::unlink(Slab** list, Slab* slab) {
+    if (slab->prev)
+        slab->prev->next = slab->next;
+    else
+        *list = slab->next;
+
+    if (slab->next) slab->next->prev = slab->prev;
+
+    slab->next = nullptr;
+    slab->prev = nullptr;
+}
\ No newline at end of file
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "lib/spinlock.hpp"
+
+class SlabCache;
+
+struct Slab {
+    SlabCache* cache = nullptr;
+    Slab* next = nullptr;
+    Slab* prev = nullptr;
+    uint8_t* objects = nullptr;
+    size_t in_use = 0;
+    size_t free_top = 0;
+
+    uint16_t* free_indices() {
+        return reinterpret_cast<uint16_t*>(this + 1);
+    }
+};
+
+class SlabCache {
+public:
+    using Constructor = void (*)(void*);
+
+    static constexpr size_t MIN_OBJECTS_PER_SLAB = 8;
+    static constexpr size_t MAX_SLAB_ORDER = 3;
+    static constexpr size_t COLOUR_STEP = 64;
+
+    void* allocate();
+    void free(void* object);
+
+    const char* get_name() const {
+        return m_name;
+    }
+    size_t get_object_size() const {
+        return m_object_size;
+    }
+    size_t get_active_objects() const {
+        return m_active_objects;
+    }
+    size_t get_total_objects() const {
+        return m_slab_count * m_objects_per_slab;
+    }
+    size_t get_slab_count() const {
+        return m_slab_count;
+    }
+    size_t get_pages_per_slab() const {
+        return 1ULL << m_order;
+    }
+
+private:
+    friend class SlabAllocator;
+
+    void initialize(const char* name, size_t size, size_t align, Constructor ctor);
+    Slab* grow();
+    void release(Slab* slab);
+    size_t header_size(size_t objects) const;
+
+    static void push(Slab** list, Slab* slab);
+    static void unlink(Slab** list, Slab* slab);
+
+    const char* m_name = nullptr;
+    size_t m_object_size = 0;
+    size_t m_stride = 0;
+    size_t m_align = 0;
+    size_t m_order = 0;
+    size_t m_objects_per_slab = 0;
+    size_t m_colours = 1;
+    size_t m_next_colour = 0;
+    Constructor m_ctor = nullptr;
+
+    Slab* m_partial = nullptr;
+    Slab* m_full = nullptr;
+    Slab* m_empty = nullptr;
+
+    size_t m_active_objects = 0;
+    size_t m_slab_count = 0;
+    size_t m_empty_count = 0;
+
+    kernel::Spinlock m_lock;
+};
+
+class SlabAllocator {
+public:
+    static constexpr size_t MAX_CACHES = 32;
+
+    static SlabAllocator& instance();
+
+    SlabCache* create_cache(const char* name, size_t size, size_t align = 8,
+                            SlabCache::Constructor ctor = nullptr);
+
+    size_t get_cache_count() const {
+        return m_cache_count;
+    }
+    const SlabCache& get_cache(size_t index) const {
+        return m_caches[index < m_cache_count ? index : 0];
+    }
+
+private:
+    SlabAllocator() = default;
+    ~SlabAllocator() = default;
+
+    SlabAllocator(const SlabAllocator&) = delete;
+    SlabAllocator& operator=(const SlabAllocator&) = delete;
+
+    SlabCache m_caches[MAX_CACHES];
+    size_t m_cache_count = 0;
+    kernel::Spinlock m_lock;
+};
\ No newline at end of file
@@ -0,0 +1,191 @@
+#include "tlb.hpp"
+
+#include "physical_memory.hpp"
+#include "virtual_memory.hpp"
+
+namespace {
+constexpr size_t FRAMES_PER_PAGE =
+    (PhysicalMemoryManager::PAGE_SIZE - sizeof(DeferredFrames)) / sizeof(void*);
+}  // namespace
+
+TLBFlushBatch::TLBFlushBatch() {
+    auto& shootdown = TLBShootdown::instance();
+    m_cpu = TLBShootdown::current_cpu();
+    m_outer = shootdown.m_batch[m_cpu];
+    if (!m_outer) shootdown.m_batch[m_cpu] = this;
+}
+
+TLBFlushBatch::~TLBFlushBatch() {
+    if (m_outer) return;
+
+    flush();
+    TLBShootdown::instance().m_batch[m_cpu] = nullptr;
+}
+
+void TLBFlushBatch::add(AddressSpace* space, uintptr_t virtual_addr) {
+    if (m_outer) {
+        m_outer->add(space, virtual_addr);
+        return;
+    }
+
+    if (m_space != space) {
+        flush();
+        m_space = space;
+    }
+
+    if (m_count < MAX_PAGES)
+        m_pages[m_count++] = virtual_addr;
+    else
+        m_full = true;
+}
+
+void TLBFlushBatch::free_frame(void* frame) {
+    if (m_outer) {
+        m_outer->free_frame(frame);
+        return;
+    }
+
+    auto& pmm = PhysicalMemoryManager::instance();
+
+    if (!m_frames || m_frames->count == FRAMES_PER_PAGE) {
+        void* storage = pmm.allocate_frame();
+        if (!storage) {
+            flush();
+            pmm.free_frame(frame);
+            return;
+        }
+
+        auto* page = phys_to_virt<DeferredFrames>(reinterpret_cast<uintptr_t>(storage));
+
+        page->next = m_frames;
+        page->count = 0;
+        m_frames = page;
+    }
+
+    m_frames->frames[m_frames->count++] = frame;
+}
+
+void TLBFlushBatch::flush() {
+    if (m_outer) {
+        m_outer->flush();
+        return;
+    }
+
+    if (m_space && (m_count || m_full))
+        TLBShootdown::instance().shootdown(m_space, m_pages, m_count, m_full);
+
+    m_count = 0;
+    m_full = false;
+
+    auto& pmm = PhysicalMemoryManager::instance();
+    while (m_frames) {
+        DeferredFrames* page = m_frames;
+        m_frames = page->next;
+
+        for (size_t i = 0; i < page->count; i++) {
+            pmm.free_frame(page->frames[i]);
+        }
+        pmm.free_frame(reinterpret_cast<void*>(virt_to_phys(page)));
+    }
+}
+
+TLBShootdown& TLBShootdown::instance() {
+    static TLBShootdown instance;
+    return instance;
+}
+
+uint32_t TLBShootdown::current_cpu() {
+    uint32_t cpu_id = kernel::SMPManager::instance().get_current_cpu_id();
+    return cpu_id < kernel::MAX_CPUS ? cpu_id : 0;
+}
+
+uint32_t TLBShootdown::online_cpus() {
+    auto& smp = kernel::SMPManager::instance();
+
+    uint32_t mask = 0;
+    for (uint32_t i = 0; i < smp.get_cpu_count() && i < kernel::MAX_CPUS; i++) {
+        kernel::CPUInfo* info = smp.get_cpu_info(i);
+        if (info && info->is_active) mask |= 1U << i;
+    }
+
+    return mask;
+}
+
+void TLBShootdown::flush_local(AddressSpace* space, const uintptr_t* pages, size_t count,
+                               bool full) {
+    auto& vmm = VirtualMemoryManager::instance();
+
+    if (full) {
+        vmm.flush_local(space);
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        vmm.invalidate_local(space, pages[i]);
+    }
+}
+
+void TLBShootdown::invalidate(AddressSpace* space, uintptr_t virtual_addr) {
+    TLBFlushBatch* batch = m_batch[current_cpu()];
+    if (batch) {
+        batch->add(space, virtual_addr);
+        return;
+    }
+
+    shootdown(space, &virtual_addr, 1, false);
+}
+
+void TLBShootdown::shootdown(AddressSpace* space, const uintptr_t* pages, size_t count,
+                             bool full) {
+    auto& vmm = VirtualMemoryManager::instance();
+
+    uint32_t self = 1U << current_cpu();
+    bool kernel_space = space == vmm.get_kernel_address_space();
+
+    flush_local(space, pages, count, full);
+
+    uint32_t online = online_cpus() & ~self;
+    uint32_t targets =
+        kernel_space ? online : __atomic_load_n(&space->active_cpus, __ATOMIC_ACQUIRE) & online;
+
+    if (!kernel_space && vmm.has_pcid())
+        __atomic_fetch_or(&space->stale_cpus, ~(targets | self), __ATOMIC_RELAXED);
+
+    __atomic_fetch_add(&m_stats.shootdowns, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&m_stats.pages, count, __ATOMIC_RELAXED);
+    if (full) __atomic_fetch_add(&m_stats.full_flushes, 1, __ATOMIC_RELAXED);
+
+    if (!targets) return;
+
+    uint64_t flags = kernel::Spinlock::save_irq();
+    while (!m_lock.try_lock()) {
+        handle_ipi();
+        asm volatile("pause");
+    }
+
+    m_space = space;
+    m_pages = pages;
+    m_count = count;
+    m_full = full;
+    __atomic_store_n(&m_pending, targets, __ATOMIC_RELEASE);
+
+    auto& smp = kernel::SMPManager::instance();
+    for (uint32_t mask = targets; mask; mask &= mask - 1) {
+        smp.send_ipi(__builtin_ctz(mask), kernel::IPI_VECTOR);
+        __atomic_fetch_add(&m_stats.ipis, 1, __ATOMIC_RELAXED);
+    }
+
+    while (__atomic_load_n(&m_pending, __ATOMIC_ACQUIRE))
+        asm volatile("pause");
+
+    m_lock.unlock();
+    kernel::Spinlock::restore_irq(flags);
+}
+
+void TLBShootdown::handle_ipi() {
+    uint32_t self = 1U << current_cpu();
+    if (!(__atomic_load_n(&m_pending, __ATOMIC_ACQUIRE) & self)) return;
+
+    flush_local(m_space, m_pages, m_count, m_full);
+    __atomic_fetch_and(&m_pending, ~self, __ATOMIC_RELEASE);
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "hw/smp.hpp"
+#include "lib/spinlock.hpp"
+
+struct AddressSpace;
+
+struct DeferredFrames {
+    DeferredFrames* next;
+    size_t count;
+    void* frames[];
+};
+
+class TLBFlushBatch {
+public:
+    static constexpr size_t MAX_PAGES = 32;
+
+    TLBFlushBatch();
+    ~TLBFlushBatch();
+
+    TLBFlushBatch(const TLBFlushBatch&) = delete;
+    TLBFlushBatch& operator=(const TLBFlushBatch&) = delete;
+
+    void add(AddressSpace* space, uintptr_t virtual_addr);
+    void free_frame(void* frame);
+    void flush();
+
+private:
+    uint32_t m_cpu = 0;
+    TLBFlushBatch* m_outer = nullptr;
+    AddressSpace* m_space = nullptr;
+    uintptr_t m_pages[MAX_PAGES] = {};
+    size_t m_count = 0;
+    bool m_full = false;
+    DeferredFrames* m_frames = nullptr;
+};
+
+struct TLBShootdownStats {
+    uint64_t shootdowns = 0;
+    uint64_t ipis = 0;
+    uint64_t full_flushes = 0;
+    uint64_t pages = 0;
+};
+
+class TLBShootdown {
+public:
+    static TLBShootdown& instance();
+
+    void invalidate(AddressSpace* space, uintptr_t virtual_addr);
+    void shootdown(AddressSpace* space, const uintptr_t* pages, size_t count, bool full);
+    void handle_ipi();
+
+    const TLBShootdownStats& get_stats() const {
+        return m_stats;
+    }
+
+private:
+    friend class TLBFlushBatch;
+
+    TLBShootdown() = default;
+    ~TLBShootdown() = default;
+
+    TLBShootdown(const TLBShootdown&) = delete;
+    TLBShootdown& operator=(const TLBShootdown&) = delete;
+
+    static void flush_local(AddressSpace* space, const uintptr_t* pages, size_t count, bool full);
+    static uint32_t current_cpu();
+    static uint32_t online_cpus();
+
+    TLBFlushBatch* m_batch[kernel::MAX_CPUS] = {};
+
+    AddressSpace* m_space = nullptr;
+    const uintptr_t* m_pages = nullptr;
+    size_t m_count = 0;
+    bool m_full = false;
+    uint32_t m_pending = 0;
+
+    TLBShootdownStats m_stats;
+    kernel::Spinlock m_lock;
+};
\ No newline at end of file
@@ -5,9 +5,12 @@
 
 #include "physical_memory.hpp"
 #include "printf.hpp"
+#include "tlb.hpp"
+#include "vga.hpp"
+
+extern "C" char __kernel_end[];
 
 namespace {
-constexpr size_t PAGE_SIZE = 4096;
 constexpr size_t ENTRIES_PER_TABLE = 512;
 
 constexpr size_t PML4_SHIFT = 39;
@@ -16,6 +19,36 @@ constexpr size_t PD_SHIFT = 21;
 constexpr size_t PT_SHIFT = 12;
 
 constexpr size_t PAGE_MASK = 0xFFFFFFFFFFFFF000;
+constexpr uintptr_t LEGACY_MEMORY_END = 0x100000;
+
+constexpr uint64_t CR4_PGE = 1ULL << 7;
+constexpr uint64_t CR4_PCIDE = 1ULL << 17;
+constexpr uint64_t CR3_NOFLUSH = 1ULL << 63;
+constexpr uint32_t CPUID_FEAT_ECX_PCID = 1U << 17;
+constexpr uint32_t CPUID_FEAT_EDX_PGE = 1U << 13;
+constexpr uint32_t CPUID_EXT_FEAT_EBX_INVPCID = 1U << 10;
+constexpr uint32_t CPUID_EXT_FEAT_EDX_PDPE1GB = 1U << 26;
+constexpr uint32_t CPUID_EXT_FEAT_EDX_NX = 1U << 20;
+constexpr uint64_t EFER_NXE = 1ULL << 11;
+
+constexpr uint64_t INVPCID_ADDRESS = 0;
+constexpr uint64_t INVPCID_CONTEXT = 1;
+constexpr uint64_t INVPCID_ALL_GLOBAL = 2;
+
+struct InvpcidDescriptor {
+    uint64_t pcid;
+    uint64_t address;
+};
+
+void invpcid(uint64_t type, uint16_t pcid, uintptr_t address) {
+    InvpcidDescriptor descriptor = {pcid, address};
+    asm volatile("invpcid %0, %1" : : "m"(descriptor), "r"(type) : "memory");
+}
+
+uint32_t current_cpu() {
+    uint32_t cpu_id = kernel::SMPManager::instance().get_current_cpu_id();
+    return cpu_id < kernel::MAX_CPUS ? cpu_id : 0;
+}
 }  // namespace
 
 VirtualMemoryManager& VirtualMemoryManager::instance() {
@@ -24,7 +57,7 @@ VirtualMemoryManager& VirtualMemoryManager::instance() {
 }
 
 void VirtualMemoryManager::initialize() {
-    volatile uint16_t* vga = reinterpret_cast<uint16_t*>(0xB8000);
+    volatile uint16_t* vga = vga_memory();
     auto write_debug = [&](const char* msg, int line, int offset = 0) {
         for (int i = 0; msg[i] != '\0'; i++) {
             vga[i + offset + (line * 80)] = 0x0200 | msg[i];
@@ -45,8 +78,11 @@ void VirtualMemoryManager::initialize() {
 
     write_debug("VMM: Starting init", 15);
 
+    detect_features();
+
     auto& pmm = PhysicalMemoryManager::instance();
-    m_pml4 = reinterpret_cast<PageTableEntry*>(pmm.allocate_frame());
+    m_pml4 = reinterpret_cast<PageTableEntry*>(
+        pmm.allocate_frame_below(PhysicalMemoryManager::BOOT_IDENTITY_LIMIT));
     if (!m_pml4) {
         write_debug("VMM: Failed to allocate PML4!", 16);
         return;
@@ -138,6 +174,19 @@ void VirtualMemoryManager::initialize() {
 
     write_debug("VMM: First 16MB mapped with 2MB pages", 30);
 
+    m_kernel_image_end = (reinterpret_cast<uintptr_t>(__kernel_end) + LARGE_PAGE_SIZE - 1) &
+                         ~(LARGE_PAGE_SIZE - 1);
+
+    for (size_t i = 8; i < ENTRIES_PER_TABLE; i++) {
+        auto& entry = pd[i];
+        entry.value = 0;
+        entry.set_huge_page(true);
+        entry.set_address(i * 0x200000);
+        entry.set_present(true);
+        entry.set_writable(true);
+        entry.set_user(false);
+    }
+
     auto kernel_pdpt = create_page_table();
     if (!kernel_pdpt) {
         write_debug("VMM: Failed to allocate kernel PDPT!", 31);
@@ -150,15 +199,54 @@ void VirtualMemoryManager::initialize() {
     m_pml4[511].set_user(false);
     write_debug("VMM: Kernel PDPT created", 32);
 
-    map_page(0xB8000, 0xB8000, true);
-    write_debug("VMM: VGA buffer mapped", 33);
+    for (size_t i = KERNEL_PML4_START; i < ENTRIES_PER_TABLE; i++) {
+        if (!get_next_level(m_pml4, i, true)) {
+            write_debug("VMM: Failed to allocate kernel half!", 32);
+            return;
+        }
+    }
+
+    m_kernel_space.pml4 = m_pml4;
+    m_pcid_bitmap[0] = 1;
+
+    if (!map_physical_memory()) {
+        write_debug("VMM: Failed to map physical memory!", 33);
+        return;
+    }
 
     write_debug("VMM: Initialization complete", 34);
 }
 
+bool VirtualMemoryManager::map_physical_memory() {
+    auto& pmm = PhysicalMemoryManager::instance();
+
+    if (!map_range(&m_kernel_space, PHYSMAP_BASE, 0, LEGACY_MEMORY_END, MAP_WRITABLE))
+        return false;
+
+    for (size_t i = 0; i < pmm.get_zone_count(); i++) {
+        const MemoryZone& zone = pmm.get_zone(i);
+        uintptr_t start = zone.start & PAGE_MASK;
+        uintptr_t end = (zone.start + zone.size + PAGE_SIZE - 1) & PAGE_MASK;
+        if (end > PHYSMAP_MAX_SIZE) end = PHYSMAP_MAX_SIZE;
+        if (start >= end) continue;
+
+        if (!map_range(&m_kernel_space, PHYSMAP_BASE + start, start, end - start, MAP_WRITABLE))
+            return false;
+    }
+
+    return true;
+}
+
 PageTableEntry* VirtualMemoryManager::create_page_table() {
     auto& pmm = PhysicalMemoryManager::instance();
-    auto table = reinterpret_cast<PageTableEntry*>(pmm.allocate_frame());
+    if (m_loaded) {
+        void* frame = pmm.allocate_zeroed_frame();
+        return frame ? phys_to_virt<PageTableEntry>(reinterpret_cast<uintptr_t>(frame)) : nullptr;
+    }
+
+    auto table = reinterpret_cast<PageTableEntry*>(
+        pmm.allocate_frame_below(PhysicalMemoryManager::BOOT_IDENTITY_LIMIT));
+    if (!table) return nullptr;
 
     for (size_t i = 0; i < ENTRIES_PER_TABLE; i++) {
         table[i].value = 0;
@@ -168,68 +256,269 @@ PageTableEntry* VirtualMemoryManager::create_page_table() {
 }
 
 PageTableEntry* VirtualMemoryManager::get_next_level(PageTableEntry* table, size_t index,
-                                                     bool create) {
+                                                     bool create, bool user) {
     if (!table[index].present() && create) {
         auto next_table = create_page_table();
-        table[index].set_address(reinterpret_cast<uint64_t>(next_table));
+        if (!next_table) return nullptr;
+        table[index].set_address(virt_to_phys(next_table));
         table[index].set_present(true);
         table[index].set_writable(true);
-        table[index].set_user(false);
+        table[index].set_user(user);
     }
 
-    if (!table[index].present()) return nullptr;
+    if (!table[index].present() || table[index].huge_page()) return nullptr;
 
-    return reinterpret_cast<PageTableEntry*>(table[index].address());
+    return phys_to_virt<PageTableEntry>(table[index].address());
 }
 
-void VirtualMemoryManager::map_page(uintptr_t virtual_addr, uintptr_t physical_addr,
+AddressSpace* VirtualMemoryManager::space_for(uintptr_t virtual_addr) {
+    return is_kernel_address(virtual_addr) ? &m_kernel_space : get_active_address_space();
+}
+
+bool VirtualMemoryManager::map_page(uintptr_t virtual_addr, uintptr_t physical_addr,
                                     bool writable) {
+    return map_page(space_for(virtual_addr), virtual_addr, physical_addr, writable);
+}
+
+bool VirtualMemoryManager::unmap_page(uintptr_t virtual_addr) {
+    return unmap_page(space_for(virtual_addr), virtual_addr);
+}
+
+uintptr_t VirtualMemoryManager::get_physical_address(uintptr_t virtual_addr) {
+    return get_physical_address(space_for(virtual_addr), virtual_addr);
+}
+
+bool VirtualMemoryManager::map_page(AddressSpace* space, uintptr_t virtual_addr,
+                                    uintptr_t physical_addr, bool writable, bool executable) {
+    uint32_t flags = (writable ? MAP_WRITABLE : 0U) | (executable ? 0U : MAP_NO_EXECUTE);
+    return map_range(space, virtual_addr & PAGE_MASK, physical_addr, PAGE_SIZE, flags);
+}
+
+bool VirtualMemoryManager::unmap_page(AddressSpace* space, uintptr_t virtual_addr) {
+    return unmap_range(space, virtual_addr, PAGE_SIZE);
+}
+
+bool VirtualMemoryManager::map_range(uintptr_t virtual_addr, uintptr_t physical_addr,
+                                     size_t length, uint32_t flags) {
+    return map_range(space_for(virtual_addr), virtual_addr, physical_addr, length, flags);
+}
+
+bool VirtualMemoryManager::unmap_range(uintptr_t virtual_addr, size_t length, bool free_frames) {
+    return unmap_range(space_for(virtual_addr), virtual_addr, length, free_frames);
+}
+
+bool VirtualMemoryManager::map_range(AddressSpace* space, uintptr_t virtual_addr,
+                                     uintptr_t physical_addr, size_t length, uint32_t flags) {
+    bool user = !is_kernel_address(virtual_addr);
+    uintptr_t end = (virtual_addr + length + PAGE_SIZE - 1) & PAGE_MASK;
     virtual_addr &= PAGE_MASK;
     physical_addr &= PAGE_MASK;
 
-    size_t pml4_index = (virtual_addr >> PML4_SHIFT) & 0x1FF;
-    size_t pdpt_index = (virtual_addr >> PDPT_SHIFT) & 0x1FF;
-    size_t pd_index = (virtual_addr >> PD_SHIFT) & 0x1FF;
-    size_t pt_index = (virtual_addr >> PT_SHIFT) & 0x1FF;
+    auto set_leaf = [&](PageTableEntry& entry, bool huge) {
+        entry.value = 0;
+        entry.set_huge_page(huge);
+        entry.set_address(physical_addr);
+        entry.set_present(true);
+        entry.set_writable(flags & MAP_WRITABLE);
+        entry.set_user(user);
+        entry.set_pcd(flags & MAP_NO_CACHE);
+        entry.set_no_execute(m_no_execute && (flags & MAP_NO_EXECUTE));
+        entry.set_global(!user && m_global_pages);
+    };
+
+    PageTableEntry* pdpt = nullptr;
+    PageTableEntry* pd = nullptr;
+    PageTableEntry* pt = nullptr;
+    uintptr_t pdpt_key = UINTPTR_MAX;
+    uintptr_t pd_key = UINTPTR_MAX;
+    uintptr_t pt_key = UINTPTR_MAX;
+
+    while (virtual_addr < end) {
+        size_t remaining = end - virtual_addr;
+        size_t step = PAGE_SIZE;
+
+        if (pdpt_key != virtual_addr >> PML4_SHIFT) {
+            pdpt_key = virtual_addr >> PML4_SHIFT;
+            pdpt = get_next_level(space->pml4, pdpt_key & 0x1FF, true, user);
+            if (!pdpt) return false;
+        }
+
+        auto& pdpt_entry = pdpt[(virtual_addr >> PDPT_SHIFT) & 0x1FF];
+        bool gigabyte_aligned = ((virtual_addr | physical_addr) & (HUGE_PAGE_SIZE - 1)) == 0;
+
+        if (pdpt_entry.present() && pdpt_entry.huge_page()) {
+            if (pdpt_entry.address() + (virtual_addr & (HUGE_PAGE_SIZE - 1)) != physical_addr)
+                return false;
+            step = HUGE_PAGE_SIZE - (virtual_addr & (HUGE_PAGE_SIZE - 1));
+        } else if (m_gigabyte_pages && gigabyte_aligned && remaining >= HUGE_PAGE_SIZE &&
+                   !pdpt_entry.present()) {
+            set_leaf(pdpt_entry, true);
+            step = HUGE_PAGE_SIZE;
+        } else {
+            if (pd_key != virtual_addr >> PDPT_SHIFT) {
+                pd_key = virtual_addr >> PDPT_SHIFT;
+                pd = get_next_level(pdpt, pd_key & 0x1FF, true, user);
+                if (!pd) return false;
+            }
+
+            auto& pd_entry = pd[(virtual_addr >> PD_SHIFT) & 0x1FF];
+            bool large_aligned = ((virtual_addr | physical_addr) & (LARGE_PAGE_SIZE - 1)) == 0;
+
+            if (pd_entry.present() && pd_entry.huge_page()) {
+                if (pd_entry.address() + (virtual_addr & (LARGE_PAGE_SIZE - 1)) != physical_addr)
+                    return false;
+                step = LARGE_PAGE_SIZE - (virtual_addr & (LARGE_PAGE_SIZE - 1));
+            } else if (large_aligned && remaining >= LARGE_PAGE_SIZE && !pd_entry.present()) {
+                set_leaf(pd_entry, true);
+                step = LARGE_PAGE_SIZE;
+            } else {
+                if (pt_key != virtual_addr >> PD_SHIFT) {
+                    pt_key = virtual_addr >> PD_SHIFT;
+                    pt = get_next_level(pd, pt_key & 0x1FF, true, user);
+                    if (!pt) return false;
+                }
+
+                auto& pt_entry = pt[(virtual_addr >> PT_SHIFT) & 0x1FF];
+                if (!pt_entry.present())
+                    set_leaf(pt_entry, false);
+                else if (pt_entry.address() != physical_addr)
+                    return false;
+            }
+        }
 
-    auto pdpt = get_next_level(m_pml4, pml4_index, true);
-    if (!pdpt) return;
+        if (step > remaining) step = remaining;
+        virtual_addr += step;
+        physical_addr += step;
+    }
 
-    auto pd = get_next_level(pdpt, pdpt_index, true);
-    if (!pd) return;
+    return true;
+}
 
-    auto pt = get_next_level(pd, pd_index, true);
-    if (!pt) return;
+PageTableEntry* VirtualMemoryManager::split_huge_page(PageTableEntry& entry, size_t child_size) {
+    auto* table = create_page_table();
+    if (!table) return nullptr;
 
-    if (!pt[pt_index].present()) {
-        pt[pt_index].set_address(physical_addr);
-        pt[pt_index].set_present(true);
-        pt[pt_index].set_writable(writable);
-        pt[pt_index].set_user(false);
+    uint64_t base = entry.address();
+    for (size_t i = 0; i < ENTRIES_PER_TABLE; i++) {
+        table[i].value = 0;
+        table[i].set_huge_page(child_size != PAGE_SIZE);
+        table[i].set_address(base + i * child_size);
+        table[i].set_present(true);
+        table[i].set_writable(entry.writable());
+        table[i].set_user(entry.user());
+        table[i].set_pwt(entry.pwt());
+        table[i].set_pcd(entry.pcd());
+        table[i].set_global(entry.global());
+        table[i].set_no_execute(entry.no_execute());
     }
+
+    bool writable = entry.writable();
+    bool user = entry.user();
+
+    entry.value = 0;
+    entry.set_address(virt_to_phys(table));
+    entry.set_present(true);
+    entry.set_writable(writable);
+    entry.set_user(user);
+
+    return table;
 }
 
-void VirtualMemoryManager::unmap_page(uintptr_t virtual_addr) {
+bool VirtualMemoryManager::unmap_range(AddressSpace* space, uintptr_t virtual_addr,
+                                       size_t length, bool free_frames) {
+    uintptr_t end = (virtual_addr + length + PAGE_SIZE - 1) & PAGE_MASK;
     virtual_addr &= PAGE_MASK;
 
-    size_t pml4_index = (virtual_addr >> PML4_SHIFT) & 0x1FF;
-    size_t pdpt_index = (virtual_addr >> PDPT_SHIFT) & 0x1FF;
-    size_t pd_index = (virtual_addr >> PD_SHIFT) & 0x1FF;
-    size_t pt_index = (virtual_addr >> PT_SHIFT) & 0x1FF;
+    AddressSpace* target = is_kernel_address(virtual_addr) ? &m_kernel_space : space;
+    auto& shootdown = TLBShootdown::instance();
+    TLBFlushBatch batch;
 
-    auto pdpt = get_next_level(m_pml4, pml4_index, false);
-    if (!pdpt) return;
+    auto covers = [&](size_t size) {
+        return (virtual_addr & (size - 1)) == 0 && end - virtual_addr >= size;
+    };
+    auto skip = [&](size_t size) {
+        uintptr_t next = (virtual_addr & ~(size - 1)) + size;
+        virtual_addr = next < end && next > virtual_addr ? next : end;
+    };
+    auto clear = [&](PageTableEntry& entry, size_t size) {
+        if (free_frames) {
+            for (size_t offset = 0; offset < size; offset += PAGE_SIZE)
+                batch.free_frame(reinterpret_cast<void*>(entry.address() + offset));
+        }
+        entry.value = 0;
+        shootdown.invalidate(target, virtual_addr);
+    };
 
-    auto pd = get_next_level(pdpt, pdpt_index, false);
-    if (!pd) return;
+    while (virtual_addr < end) {
+        auto pdpt = get_next_level(space->pml4, (virtual_addr >> PML4_SHIFT) & 0x1FF, false);
+        if (!pdpt) {
+            skip(1ULL << PML4_SHIFT);
+            continue;
+        }
 
-    auto pt = get_next_level(pd, pd_index, false);
-    if (!pt) return;
+        auto& pdpt_entry = pdpt[(virtual_addr >> PDPT_SHIFT) & 0x1FF];
+        if (!pdpt_entry.present()) {
+            skip(HUGE_PAGE_SIZE);
+            continue;
+        }
+
+        if (pdpt_entry.huge_page()) {
+            if (covers(HUGE_PAGE_SIZE)) {
+                clear(pdpt_entry, HUGE_PAGE_SIZE);
+                virtual_addr += HUGE_PAGE_SIZE;
+                continue;
+            }
+            if (!split_huge_page(pdpt_entry, LARGE_PAGE_SIZE)) return false;
+        }
 
-    pt[pt_index].value = 0;
+        auto pd = phys_to_virt<PageTableEntry>(pdpt_entry.address());
+        auto& pd_entry = pd[(virtual_addr >> PD_SHIFT) & 0x1FF];
+        if (!pd_entry.present()) {
+            skip(LARGE_PAGE_SIZE);
+            continue;
+        }
+
+        if (pd_entry.huge_page()) {
+            if (covers(LARGE_PAGE_SIZE)) {
+                clear(pd_entry, LARGE_PAGE_SIZE);
+                virtual_addr += LARGE_PAGE_SIZE;
+                continue;
+            }
+            if (!split_huge_page(pd_entry, PAGE_SIZE)) return false;
+        }
+
+        auto pt = phys_to_virt<PageTableEntry>(pd_entry.address());
+        auto& pt_entry = pt[(virtual_addr >> PT_SHIFT) & 0x1FF];
+        if (pt_entry.present()) clear(pt_entry, PAGE_SIZE);
+        virtual_addr += PAGE_SIZE;
+    }
+
+    return true;
 }
 
-uintptr_t VirtualMemoryManager::get_physical_address(uintptr_t virtual_addr) {
+void VirtualMemoryManager::invalidate_local(AddressSpace* space, uintptr_t virtual_addr) {
+    if (is_kernel_address(virtual_addr)) {
+        asm volatile("invlpg (%0)" : : "r"(virtual_addr) : "memory");
+        if (m_pcid && !m_global_pages)
+            __atomic_fetch_add(&m_kernel_generation, 1, __ATOMIC_RELEASE);
+        return;
+    }
+
+    if (space == get_active_address_space()) {
+        asm volatile("invlpg (%0)" : : "r"(virtual_addr) : "memory");
+        return;
+    }
+
+    if (!m_pcid) return;
+
+    if (m_invpcid)
+        invpcid(INVPCID_ADDRESS, space->pcid, virtual_addr);
+    else
+        __atomic_fetch_or(&space->stale_cpus, 1U << current_cpu(), __ATOMIC_RELAXED);
+}
+
+uintptr_t VirtualMemoryManager::get_physical_address(AddressSpace* space,
+                                                     uintptr_t virtual_addr) {
     virtual_addr &= PAGE_MASK;
 
     size_t pml4_index = (virtual_addr >> PML4_SHIFT) & 0x1FF;
@@ -237,12 +526,19 @@ uintptr_t VirtualMemoryManager::get_physical_address(uintptr_t virtual_addr) {
     size_t pd_index = (virtual_addr >> PD_SHIFT) & 0x1FF;
     size_t pt_index = (virtual_addr >> PT_SHIFT) & 0x1FF;
 
-    auto pdpt = get_next_level(m_pml4, pml4_index, false);
+    auto pdpt = get_next_level(space->pml4, pml4_index, false);
     if (!pdpt) return 0;
 
+    if (pdpt[pdpt_index].present() && pdpt[pdpt_index].huge_page())
+        return (pdpt[pdpt_index].address() & ~(HUGE_PAGE_SIZE - 1)) |
+               (virtual_addr & (HUGE_PAGE_SIZE - 1));
+
     auto pd = get_next_level(pdpt, pdpt_index, false);
     if (!pd) return 0;
 
+    if (pd[pd_index].present() && pd[pd_index].huge_page())
+        return pd[pd_index].address() | (virtual_addr & 0x1FFFFF);
+
     auto pt = get_next_level(pd, pd_index, false);
     if (!pt) return 0;
 
@@ -251,6 +547,285 @@ uintptr_t VirtualMemoryManager::get_physical_address(uintptr_t virtual_addr) {
     return (pt[pt_index].address() & PAGE_MASK) | (virtual_addr & ~PAGE_MASK);
 }
 
+bool VirtualMemoryManager::share_range(AddressSpace* source, AddressSpace* target,
+                                       uintptr_t virtual_addr, size_t length) {
+    auto& pmm = PhysicalMemoryManager::instance();
+    uintptr_t end = (virtual_addr + length + PAGE_SIZE - 1) & PAGE_MASK;
+    virtual_addr &= PAGE_MASK;
+
+    TLBFlushBatch batch;
+    while (virtual_addr < end) {
+        uintptr_t table_end = (virtual_addr + LARGE_PAGE_SIZE) & ~(LARGE_PAGE_SIZE - 1);
+        if (table_end > end || table_end < virtual_addr) table_end = end;
+
+        PageTableEntry* source_pt = is_kernel_address(virtual_addr)
+                                        ? nullptr
+                                        : find_page_table(source, virtual_addr, false);
+        if (!source_pt) {
+            virtual_addr = table_end;
+            continue;
+        }
+
+        PageTableEntry* target_pt = find_page_table(target, virtual_addr, true);
+        if (!target_pt) return false;
+
+        for (; virtual_addr < table_end; virtual_addr += PAGE_SIZE) {
+            size_t index = (virtual_addr >> PT_SHIFT) & 0x1FF;
+            PageTableEntry& entry = source_pt[index];
+            if (!entry.present()) continue;
+
+            if (entry.writable()) batch.add(source, virtual_addr);
+            entry.set_writable(false);
+            entry.set_copy_on_write(true);
+
+            pmm.share_frame(reinterpret_cast<void*>(entry.address()));
+            target_pt[index] = entry;
+        }
+    }
+
+    return true;
+}
+
+void VirtualMemoryManager::protect_range(AddressSpace* space, uintptr_t virtual_addr,
+                                        size_t length, bool writable, bool executable) {
+    uintptr_t end = (virtual_addr + length + PAGE_SIZE - 1) & PAGE_MASK;
+    virtual_addr &= PAGE_MASK;
+
+    auto& pmm = PhysicalMemoryManager::instance();
+    TLBFlushBatch batch;
+    while (virtual_addr < end) {
+        uintptr_t table_end = (virtual_addr + LARGE_PAGE_SIZE) & ~(LARGE_PAGE_SIZE - 1);
+        if (table_end > end || table_end < virtual_addr) table_end = end;
+
+        PageTableEntry* pt = is_kernel_address(virtual_addr)
+                                 ? nullptr
+                                 : find_page_table(space, virtual_addr, false);
+        if (!pt) {
+            virtual_addr = table_end;
+            continue;
+        }
+
+        for (; virtual_addr < table_end; virtual_addr += PAGE_SIZE) {
+            PageTableEntry& entry = pt[(virtual_addr >> PT_SHIFT) & 0x1FF];
+            if (!entry.present()) continue;
+
+            bool no_execute = m_no_execute && !executable;
+            bool changed = entry.no_execute() != no_execute;
+            entry.set_no_execute(no_execute);
+
+            if (!entry.copy_on_write() && entry.writable() != writable) {
+                if (writable && pmm.get_frame_refs(reinterpret_cast<void*>(entry.address())) > 1) {
+                    entry.set_copy_on_write(true);
+                } else {
+                    entry.set_writable(writable);
+                    changed = true;
+                }
+            }
+
+            if (changed) batch.add(space, virtual_addr);
+        }
+    }
+}
+
+size_t VirtualMemoryManager::release_range(AddressSpace* space, uintptr_t virtual_addr,
+                                           size_t length) {
+    uintptr_t end = (virtual_addr + length + PAGE_SIZE - 1) & PAGE_MASK;
+    virtual_addr &= PAGE_MASK;
+
+    auto skip = [&](size_t size) {
+        uintptr_t next = (virtual_addr & ~(size - 1)) + size;
+        virtual_addr = next < end && next > virtual_addr ? next : end;
+    };
+
+    size_t released = 0;
+    TLBFlushBatch batch;
+    while (virtual_addr < end) {
+        auto pdpt = get_next_level(space->pml4, (virtual_addr >> PML4_SHIFT) & 0x1FF, false);
+        if (!pdpt) {
+            skip(1ULL << PML4_SHIFT);
+            continue;
+        }
+
+        auto pd = get_next_level(pdpt, (virtual_addr >> PDPT_SHIFT) & 0x1FF, false);
+        if (!pd) {
+            skip(HUGE_PAGE_SIZE);
+            continue;
+        }
+
+        auto pt = get_next_level(pd, (virtual_addr >> PD_SHIFT) & 0x1FF, false);
+        if (!pt) {
+            skip(LARGE_PAGE_SIZE);
+            continue;
+        }
+
+        uintptr_t table_end = (virtual_addr + LARGE_PAGE_SIZE) & ~(LARGE_PAGE_SIZE - 1);
+        if (table_end > end || table_end < virtual_addr) table_end = end;
+
+        for (; virtual_addr < table_end; virtual_addr += PAGE_SIZE) {
+            PageTableEntry& entry = pt[(virtual_addr >> PT_SHIFT) & 0x1FF];
+            if (!entry.present()) continue;
+
+            batch.free_frame(reinterpret_cast<void*>(entry.address()));
+            entry.value = 0;
+            batch.add(space, virtual_addr);
+            released++;
+        }
+    }
+
+    return released;
+}
+
+bool VirtualMemoryManager::resolve_copy_on_write(AddressSpace* space, uintptr_t virtual_addr) {
+    virtual_addr &= PAGE_MASK;
+
+    PageTableEntry* pt = find_page_table(space, virtual_addr, false);
+    if (!pt) return false;
+
+    PageTableEntry& entry = pt[(virtual_addr >> PT_SHIFT) & 0x1FF];
+    if (!entry.present() || !entry.copy_on_write()) return false;
+
+    auto& pmm = PhysicalMemoryManager::instance();
+    void* frame = reinterpret_cast<void*>(entry.address());
+
+    if (pmm.get_frame_refs(frame) > 1) {
+        void* copy = pmm.allocate_frame();
+        if (!copy) return false;
+
+        memcpy(phys_to_virt(reinterpret_cast<uintptr_t>(copy)),
+               phys_to_virt(reinterpret_cast<uintptr_t>(frame)), PAGE_SIZE);
+        entry.set_address(reinterpret_cast<uint64_t>(copy));
+        pmm.free_frame(frame);
+    }
+
+    entry.set_copy_on_write(false);
+    entry.set_writable(true);
+    TLBShootdown::instance().invalidate(space, virtual_addr);
+    return true;
+}
+
+PageTableEntry* VirtualMemoryManager::find_page_table(AddressSpace* space, uintptr_t virtual_addr,
+                                                      bool create) {
+    bool user = !is_kernel_address(virtual_addr);
+
+    auto pdpt = get_next_level(space->pml4, (virtual_addr >> PML4_SHIFT) & 0x1FF, create, user);
+    if (!pdpt) return nullptr;
+
+    auto pd = get_next_level(pdpt, (virtual_addr >> PDPT_SHIFT) & 0x1FF, create, user);
+    if (!pd) return nullptr;
+
+    return get_next_level(pd, (virtual_addr >> PD_SHIFT) & 0x1FF, create, user);
+}
+
+AddressSpace* VirtualMemoryManager::create_address_space() {
+    uint16_t pcid = allocate_pcid();
+    if (m_pcid && !pcid) return nullptr;
+
+    void* frame = PhysicalMemoryManager::instance().allocate_zeroed_frame();
+    if (!frame) {
+        free_pcid(pcid);
+        return nullptr;
+    }
+
+    auto* pml4 = phys_to_virt<PageTableEntry>(reinterpret_cast<uintptr_t>(frame));
+
+    for (size_t i = KERNEL_PML4_START; i < ENTRIES_PER_TABLE; i++) {
+        pml4[i] = m_pml4[i];
+    }
+
+    auto* space = new AddressSpace;
+    space->pml4 = pml4;
+    space->pcid = pcid;
+    space->stale_cpus = ~0U;
+
+    if (!share_kernel_image(space)) {
+        destroy_address_space(space);
+        return nullptr;
+    }
+
+    return space;
+}
+
+bool VirtualMemoryManager::share_kernel_image(AddressSpace* space) {
+    auto kernel_pdpt = get_next_level(m_pml4, 0, false);
+    auto kernel_pd = kernel_pdpt ? get_next_level(kernel_pdpt, 0, false) : nullptr;
+    if (!kernel_pd) return false;
+
+    auto pdpt = get_next_level(space->pml4, 0, true, true);
+    auto pd = pdpt ? get_next_level(pdpt, 0, true, true) : nullptr;
+    if (!pd) return false;
+
+    for (size_t i = 0; i < m_kernel_image_end / LARGE_PAGE_SIZE; i++) {
+        pd[i] = kernel_pd[i];
+        pd[i].set_global(m_global_pages);
+    }
+
+    return true;
+}
+
+void VirtualMemoryManager::destroy_address_space(AddressSpace* space) {
+    if (!space || space == &m_kernel_space) return;
+
+    for (uint32_t cpu = 0; cpu < kernel::MAX_CPUS; cpu++) {
+        if (m_active[cpu] == space) {
+            if (cpu == current_cpu())
+                activate(&m_kernel_space);
+            else
+                m_active[cpu] = &m_kernel_space;
+        }
+    }
+
+    for (size_t i = 0; i < KERNEL_PML4_START; i++) {
+        if (space->pml4[i].present())
+            free_page_tables(phys_to_virt<PageTableEntry>(space->pml4[i].address()), 3);
+    }
+
+    if (m_pcid && m_invpcid) invpcid(INVPCID_CONTEXT, space->pcid, 0);
+
+    PhysicalMemoryManager::instance().free_frame(
+        reinterpret_cast<void*>(virt_to_phys(space->pml4)));
+    free_pcid(space->pcid);
+    delete space;
+}
+
+void VirtualMemoryManager::free_page_tables(PageTableEntry* table, size_t level) {
+    if (level > 1) {
+        for (size_t i = 0; i < ENTRIES_PER_TABLE; i++) {
+            if (table[i].present() && !table[i].huge_page())
+                free_page_tables(phys_to_virt<PageTableEntry>(table[i].address()), level - 1);
+        }
+    }
+
+    PhysicalMemoryManager::instance().free_frame(reinterpret_cast<void*>(virt_to_phys(table)));
+}
+
+uint16_t VirtualMemoryManager::allocate_pcid() {
+    if (!m_pcid) return 0;
+
+    kernel::ScopedLock guard(m_pcid_lock);
+
+    for (size_t word = 0; word < MAX_PCID / 64; word++) {
+        if (m_pcid_bitmap[word] == ~0ULL) continue;
+
+        size_t bit = __builtin_ctzll(~m_pcid_bitmap[word]);
+        m_pcid_bitmap[word] |= 1ULL << bit;
+        return word * 64 + bit;
+    }
+
+    return 0;
+}
+
+void VirtualMemoryManager::free_pcid(uint16_t pcid) {
+    if (!pcid) return;
+
+    kernel::ScopedLock guard(m_pcid_lock);
+    m_pcid_bitmap[pcid / 64] &= ~(1ULL << (pcid % 64));
+}
+
+AddressSpace* VirtualMemoryManager::get_active_address_space() {
+    AddressSpace* space = m_active[current_cpu()];
+    return space ? space : &m_kernel_space;
+}
+
 extern "C" {
 uint64_t read_cr4();
 void write_cr4(uint64_t value);
@@ -263,7 +838,7 @@ void flush_tlb();
 }
 
 void VirtualMemoryManager::load_page_directory() {
-    volatile uint16_t* vga = reinterpret_cast<uint16_t*>(0xB8000);
+    volatile uint16_t* vga = vga_memory();
     auto write_debug = [&](const char* msg, int line, int offset = 0) {
         for (int i = 0; msg[i] != '\0'; i++) {
             vga[i + offset + (line * 80)] = 0x0400 | msg[i];
@@ -295,9 +870,120 @@ void VirtualMemoryManager::load_page_directory() {
         vga[i + 16 + (26 * 80)] = 0x0400 | hex[i];
     }
 
-    write_cr3(reinterpret_cast<uint64_t>(m_pml4));
+    write_cr3(virt_to_phys(m_pml4));
+    m_loaded = true;
+    m_physmap_offset = PHYSMAP_BASE;
+    m_pml4 = phys_to_virt<PageTableEntry>(reinterpret_cast<uintptr_t>(m_pml4));
+    m_kernel_space.pml4 = m_pml4;
+    PhysicalMemoryManager::instance().relocate_metadata();
     write_debug("VMM: CR3 updated", 27);
 
     flush_tlb();
     write_debug("VMM: TLB flushed", 28);
+
+    initialize_cpu();
+}
+
+void VirtualMemoryManager::detect_features() {
+    uint32_t eax, ebx, ecx, edx;
+    asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(1));
+    m_pcid = (ecx & CPUID_FEAT_ECX_PCID) != 0;
+    m_global_pages = (edx & CPUID_FEAT_EDX_PGE) != 0;
+
+    asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(7), "c"(0));
+    m_invpcid = m_pcid && (ebx & CPUID_EXT_FEAT_EBX_INVPCID) != 0;
+
+    asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0x80000000));
+    if (eax >= 0x80000001) {
+        asm volatile("cpuid" : "=a"(eax), "=b"(ebx), "=c"(ecx), "=d"(edx) : "a"(0x80000001));
+        m_gigabyte_pages = (edx & CPUID_EXT_FEAT_EDX_PDPE1GB) != 0;
+        m_no_execute = (edx & CPUID_EXT_FEAT_EDX_NX) != 0;
+    }
+}
+
+void VirtualMemoryManager::initialize_cpu() {
+    m_active[current_cpu()] = &m_kernel_space;
+
+    if (m_global_pages) write_cr4(read_cr4() | CR4_PGE);
+    if (m_no_execute) write_efer(read_efer() | EFER_NXE);
+    if (!m_pcid) return;
+
+    write_cr3(virt_to_phys(m_pml4));
+    write_cr4(read_cr4() | CR4_PCIDE);
+}
+
+void VirtualMemoryManager::flush_local(AddressSpace* space) {
+    if (space == &m_kernel_space) {
+        flush_global();
+        return;
+    }
+
+    if (space == get_active_address_space()) {
+        flush_tlb();
+        return;
+    }
+
+    if (!m_pcid) return;
+
+    if (m_invpcid)
+        invpcid(INVPCID_CONTEXT, space->pcid, 0);
+    else
+        __atomic_fetch_or(&space->stale_cpus, 1U << current_cpu(), __ATOMIC_RELAXED);
+}
+
+void VirtualMemoryManager::flush_global() {
+    if (!m_global_pages) {
+        flush_tlb();
+        if (m_pcid) __atomic_fetch_add(&m_kernel_generation, 1, __ATOMIC_RELEASE);
+        return;
+    }
+
+    if (m_invpcid) {
+        invpcid(INVPCID_ALL_GLOBAL, 0, 0);
+        return;
+    }
+
+    uint64_t cr4 = read_cr4();
+    if (cr4 & CR4_PGE) write_cr4(cr4 & ~CR4_PGE);
+    write_cr4(cr4 | CR4_PGE);
+}
+
+void VirtualMemoryManager::set_global_pages(bool enabled) {
+    if (!m_global_pages) return;
+
+    uint64_t cr4 = read_cr4();
+    write_cr4(enabled ? cr4 | CR4_PGE : cr4 & ~CR4_PGE);
+}
+
+void VirtualMemoryManager::activate(AddressSpace* space, bool flush) {
+    if (!space) space = &m_kernel_space;
+
+    uint32_t cpu = current_cpu();
+    uint32_t bit = 1U << cpu;
+    uint64_t cr3 = virt_to_phys(space->pml4);
+
+    if (m_pcid) {
+        bool stale = __atomic_fetch_and(&space->stale_cpus, ~bit, __ATOMIC_RELAXED) & bit;
+
+        uint32_t generation = __atomic_load_n(&m_kernel_generation, __ATOMIC_ACQUIRE);
+        if (space->kernel_generation[cpu] != generation) {
+            space->kernel_generation[cpu] = generation;
+            stale = true;
+        }
+
+        if (!flush && !stale && m_active[cpu] == space) return;
+
+        cr3 |= space->pcid;
+        if (!flush && !stale) cr3 |= CR3_NOFLUSH;
+    } else if (!flush && m_active[cpu] == space)
+        return;
+
+    AddressSpace* previous = m_active[cpu];
+
+    __atomic_fetch_or(&space->active_cpus, bit, __ATOMIC_ACQ_REL);
+    m_active[cpu] = space;
+    write_cr3(cr3);
+
+    if (previous && previous != space)
+        __atomic_fetch_and(&previous->active_cpus, ~bit, __ATOMIC_RELEASE);
 }
\ No newline at end of file
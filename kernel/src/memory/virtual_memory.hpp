@@ -3,6 +3,9 @@
 #include <cstddef>
 #include <cstdint>
 
+#include "hw/smp.hpp"
+#include "lib/spinlock.hpp"
+
 struct PageTableEntry {
     uint64_t value = 0;
 
@@ -33,6 +36,12 @@ struct PageTableEntry {
     bool global() const {
         return value & (1ULL << 8);
     }
+    bool copy_on_write() const {
+        return value & (1ULL << 9);
+    }
+    bool no_execute() const {
+        return value & (1ULL << 63);
+    }
     uint64_t address() const {
         if (huge_page()) return value & 0xFFFFFFFE00000ULL;
         return value & 0xFFFFFFFFF000ULL;
@@ -65,26 +74,115 @@ struct PageTableEntry {
     void set_global(bool x) {
         value = (value & ~(1ULL << 8)) | (x ? (1ULL << 8) : 0);
     }
+    void set_copy_on_write(bool x) {
+        value = (value & ~(1ULL << 9)) | (x ? (1ULL << 9) : 0);
+    }
+    void set_no_execute(bool x) {
+        value = (value & ~(1ULL << 63)) | (x ? (1ULL << 63) : 0);
+    }
     void set_address(uint64_t addr) {
         if (huge_page()) {
-            uint64_t flags = value & 0x1FFFFF;
-            value = flags | (addr & ~0x1FFFFF);
+            uint64_t flags = value & (0x1FFFFF | (1ULL << 63));
+            value = flags | (addr & 0xFFFFFFFE00000ULL);
         } else {
-            uint64_t flags = value & 0xFFF;
-            value = flags | (addr & ~0xFFF);
+            uint64_t flags = value & (0xFFF | (1ULL << 63));
+            value = flags | (addr & 0xFFFFFFFFFF000ULL);
         }
     }
 };
 
+enum MapFlags : uint32_t {
+    MAP_WRITABLE = 1U << 0,
+    MAP_NO_CACHE = 1U << 1,
+    MAP_NO_EXECUTE = 1U << 2,
+};
+
+struct AddressSpace {
+    PageTableEntry* pml4 = nullptr;
+    uint16_t pcid = 0;
+    uint32_t stale_cpus = 0;
+    uint32_t active_cpus = 0;
+    uint32_t kernel_generation[kernel::MAX_CPUS] = {};
+};
+
 class VirtualMemoryManager {
 public:
+    static constexpr size_t PAGE_SIZE = 4096;
+    static constexpr size_t LARGE_PAGE_SIZE = 2 * 1024 * 1024;
+    static constexpr size_t HUGE_PAGE_SIZE = 1024 * 1024 * 1024;
+    static constexpr uintptr_t PHYSMAP_BASE = 0xFFFF800000000000;
+    static constexpr size_t PHYSMAP_MAX_SIZE = 64ULL * 1024 * 1024 * 1024 * 1024;
+    static constexpr size_t KERNEL_PML4_START = 256;
+    static constexpr size_t MAX_PCID = 4096;
+
     static VirtualMemoryManager& instance();
 
+    static bool is_kernel_address(uintptr_t virtual_addr) {
+        size_t pml4_index = (virtual_addr >> 39) & 0x1FF;
+        return pml4_index >= KERNEL_PML4_START;
+    }
+
+    bool is_user_address(uintptr_t virtual_addr) const {
+        return virtual_addr >= m_kernel_image_end && !is_kernel_address(virtual_addr);
+    }
+
     void initialize();
-    void map_page(uintptr_t virtual_addr, uintptr_t physical_addr, bool writable = true);
-    void unmap_page(uintptr_t virtual_addr);
+    void initialize_cpu();
+    bool map_page(uintptr_t virtual_addr, uintptr_t physical_addr, bool writable = true);
+    bool unmap_page(uintptr_t virtual_addr);
     uintptr_t get_physical_address(uintptr_t virtual_addr);
 
+    bool map_range(uintptr_t virtual_addr, uintptr_t physical_addr, size_t length,
+                   uint32_t flags = MAP_WRITABLE);
+    bool unmap_range(uintptr_t virtual_addr, size_t length, bool free_frames = false);
+
+    bool map_page(AddressSpace* space, uintptr_t virtual_addr, uintptr_t physical_addr,
+                  bool writable = true, bool executable = true);
+    bool map_range(AddressSpace* space, uintptr_t virtual_addr, uintptr_t physical_addr,
+                   size_t length, uint32_t flags = MAP_WRITABLE);
+    bool unmap_range(AddressSpace* space, uintptr_t virtual_addr, size_t length,
+                     bool free_frames = false);
+    bool unmap_page(AddressSpace* space, uintptr_t virtual_addr);
+    uintptr_t get_physical_address(AddressSpace* space, uintptr_t virtual_addr);
+
+    bool share_range(AddressSpace* source, AddressSpace* target, uintptr_t virtual_addr,
+                     size_t length);
+    void protect_range(AddressSpace* space, uintptr_t virtual_addr, size_t length, bool writable,
+                       bool executable);
+    size_t release_range(AddressSpace* space, uintptr_t virtual_addr, size_t length);
+    bool resolve_copy_on_write(AddressSpace* space, uintptr_t virtual_addr);
+
+    AddressSpace* create_address_space();
+    void destroy_address_space(AddressSpace* space);
+    void activate(AddressSpace* space, bool flush = false);
+    void invalidate_local(AddressSpace* space, uintptr_t virtual_addr);
+    void flush_local(AddressSpace* space);
+    void flush_global();
+    void set_global_pages(bool enabled);
+    AddressSpace* get_active_address_space();
+    AddressSpace* get_kernel_address_space() {
+        return &m_kernel_space;
+    }
+
+    bool has_pcid() const {
+        return m_pcid;
+    }
+    bool has_invpcid() const {
+        return m_invpcid;
+    }
+    bool has_global_pages() const {
+        return m_global_pages;
+    }
+    bool has_gigabyte_pages() const {
+        return m_gigabyte_pages;
+    }
+    bool has_no_execute() const {
+        return m_no_execute;
+    }
+    static uintptr_t get_physmap_offset() {
+        return m_physmap_offset;
+    }
+
     void load_page_directory();
 
 private:
@@ -94,8 +192,46 @@ private:
     VirtualMemoryManager(const VirtualMemoryManager&) = delete;
     VirtualMemoryManager& operator=(const VirtualMemoryManager&) = delete;
 
+    void detect_features();
+    bool map_physical_memory();
     PageTableEntry* create_page_table();
-    PageTableEntry* get_next_level(PageTableEntry* table, size_t index, bool create);
+    PageTableEntry* get_next_level(PageTableEntry* table, size_t index, bool create,
+                                   bool user = false);
+    PageTableEntry* split_huge_page(PageTableEntry& entry, size_t child_size);
+    PageTableEntry* find_page_table(AddressSpace* space, uintptr_t virtual_addr, bool create);
+    AddressSpace* space_for(uintptr_t virtual_addr);
+    bool share_kernel_image(AddressSpace* space);
+    void free_page_tables(PageTableEntry* table, size_t level);
+    uint16_t allocate_pcid();
+    void free_pcid(uint16_t pcid);
+
+    static inline uintptr_t m_physmap_offset = 0;
 
     PageTableEntry* m_pml4 = nullptr;
-};
\ No newline at end of file
+    uintptr_t m_kernel_image_end = 0;
+    bool m_loaded = false;
+    bool m_pcid = false;
+    bool m_invpcid = false;
+    bool m_gigabyte_pages = false;
+    bool m_no_execute = false;
+    bool m_global_pages = false;
+    uint32_t m_kernel_generation = 0;
+
+    AddressSpace m_kernel_space;
+    AddressSpace* m_active[kernel::MAX_CPUS] = {};
+    uint64_t m_pcid_bitmap[MAX_PCID / 64] = {};
+    kernel::Spinlock m_pcid_lock;
+};
+
+template <typename T = void>
+inline T* phys_to_virt(uintptr_t physical_addr) {
+    return reinterpret_cast<T*>(physical_addr + VirtualMemoryManager::get_physmap_offset());
+}
+
+inline uintptr_t virt_to_phys(const void* virtual_addr) {
+    uintptr_t addr = reinterpret_cast<uintptr_t>(virtual_addr);
+    if (addr >= VirtualMemoryManager::PHYSMAP_BASE &&
+        addr - VirtualMemoryManager::PHYSMAP_BASE < VirtualMemoryManager::PHYSMAP_MAX_SIZE)
+        return addr - VirtualMemoryManager::PHYSMAP_BASE;
+    return addr;
+}
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "commands.hpp"
 #include "core/process.hpp"
 #include "fs/fat32.hpp"
+#include "memory/scratch.hpp"
 #include "printf.hpp"
 
 namespace commands {
@@ -29,8 +30,11 @@ void load_aliases() {
                                  strlen(default_aliases), 0);
     }
 
-    uint8_t buffer[4096] = {0};
-    if (fs.readFileByPath("/shell/config", buffer, sizeof(buffer) - 1)) {
+    constexpr size_t BUFFER_SIZE = 4096;
+    ScratchScope scratch;
+    auto* buffer = static_cast<uint8_t*>(scratch.allocate_zeroed(BUFFER_SIZE));
+
+    if (buffer && fs.readFileByPath("/shell/config", buffer, BUFFER_SIZE - 1)) {
         char* content = reinterpret_cast<char*>(buffer);
         char* line_start = content;
         char* line_end;
@@ -0,0 +1,138 @@
+#include "../shell.hpp"
+#include "commands.hpp"
+#include "core/process.hpp"
+#include "core/scheduler.hpp"
+#include "printf.hpp"
+#include "sim_processes.hpp"
+
+namespace commands {
+
+namespace {
+constexpr size_t TASK_COUNT = 16;
+constexpr uint64_t BASE_WORK = 50;
+constexpr size_t CPU_COUNTS[] = {1, 2, 4, 8};
+constexpr uint64_t MAX_TICKS = 100000;
+constexpr uint8_t TASK_PRIORITY = 5;
+
+struct SimTask {
+    uint64_t remaining = 0;
+    uint32_t last_cpu = 0;
+    bool started = false;
+};
+
+struct ScaleResult {
+    uint64_t ticks = 0;
+    uint64_t busy_ticks = 0;
+    uint64_t migrations = 0;
+    uint64_t work = 0;
+};
+
+bool simulate(size_t cpu_count, bool balance, ScaleResult& result) {
+    auto& scheduler = kernel::Scheduler::instance();
+
+    SimProcesses processes(TASK_COUNT);
+    if (!processes.valid()) return false;
+
+    auto* runqueues = new kernel::CPURunQueue[cpu_count];
+    if (!runqueues) return false;
+
+    for (size_t cpu = 0; cpu < cpu_count; cpu++) {
+        runqueues[cpu].policy = kernel::SchedulerPolicy::Fair;
+        runqueues[cpu].cpu_id = cpu;
+    }
+
+    SimTask tasks[TASK_COUNT];
+
+    for (size_t i = 0; i < TASK_COUNT; i++) {
+        processes[i]->priority = TASK_PRIORITY;
+        tasks[i].remaining = BASE_WORK * (1 + i % 4);
+        result.work += tasks[i].remaining;
+        scheduler.wake_process(&runqueues[0], processes[i]);
+    }
+
+    size_t finished = 0;
+    uint64_t now = 0;
+
+    for (; finished < TASK_COUNT && now < MAX_TICKS; now++) {
+        for (size_t cpu = 0; cpu < cpu_count; cpu++) {
+            kernel::CPURunQueue* runqueue = &runqueues[cpu];
+
+            if (balance) scheduler.balance_tick(runqueues, cpu_count, runqueue);
+
+            if (!runqueue->current || runqueue->needs_resched)
+                scheduler.pick_next_process(runqueue);
+            if (!runqueue->current && balance &&
+                scheduler.idle_balance(runqueues, cpu_count, runqueue))
+                scheduler.pick_next_process(runqueue);
+
+            kernel::Process* current = runqueue->current;
+            bool resched = scheduler.account_tick(runqueue);
+            if (!current) continue;
+
+            SimTask& task = tasks[SimProcesses::index_of(current)];
+            if (task.started && task.last_cpu != cpu) result.migrations++;
+            task.started = true;
+            task.last_cpu = cpu;
+            result.busy_ticks++;
+
+            if (--task.remaining == 0) {
+                current->state = kernel::ProcessState::Stopped;
+                finished++;
+                resched = true;
+            }
+
+            if (resched) scheduler.pick_next_process(runqueue);
+        }
+    }
+
+    result.ticks = now;
+    delete[] runqueues;
+
+    return finished == TASK_COUNT;
+}
+
+uint64_t throughput(const ScaleResult& result) {
+    return result.ticks ? result.work * 1000 / result.ticks : 0;
+}
+}  // namespace
+
+void cmd_balancesim() {
+    auto& pm = kernel::ProcessManager::instance();
+    pid_t pid = pm.create_process("balancesim", shell_pid);
+
+    printf("Simulated %zu CPU-bound tasks (%lu-%lu ticks of work each), all forked on vCPU 0\n",
+           TASK_COUNT, BASE_WORK, BASE_WORK * 4);
+    printf("vCPUs are private runqueues stepped on this CPU: this measures the balancing\n");
+    printf("algorithm only, not lock contention or hardware scaling\n\n");
+
+    printf("vCPUs | no balancing     | steal + balance  | util | speedup | migrations\n");
+    printf("      | ticks  | work/kt | ticks  | work/kt |      |         |\n");
+    printf("------+--------+---------+--------+---------+------+---------+-----------\n");
+
+    uint64_t baseline = 0;
+
+    for (size_t cpu_count : CPU_COUNTS) {
+        ScaleResult isolated;
+        ScaleResult balanced;
+        if (!simulate(cpu_count, false, isolated) || !simulate(cpu_count, true, balanced)) {
+            set_red();
+            printf("Error: Simulation on %zu vCPUs did not complete\n", cpu_count);
+            reset_color();
+            break;
+        }
+
+        if (!baseline) baseline = throughput(balanced);
+        uint64_t speedup = baseline ? throughput(balanced) * 100 / baseline : 0;
+        uint64_t utilization = balanced.busy_ticks * 100 / (balanced.ticks * cpu_count);
+
+        printf("%5zu | %6lu | %7lu | %6lu | %7lu | %3lu%% | %3lu.%02lux | %10lu\n", cpu_count,
+               isolated.ticks, throughput(isolated), balanced.ticks, throughput(balanced),
+               utilization, speedup / 100, speedup % 100, balanced.migrations);
+    }
+
+    printf("\nwork/kt is completed task-ticks per 1000 ticks of wall time\n");
+
+    pm.terminate_process(pid);
+}
+
+}  // namespace commands
\ No newline at end of file
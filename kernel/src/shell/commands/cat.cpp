@@ -2,7 +2,7 @@
 #include "commands.hpp"
 #include "core/process.hpp"
 #include "fs/fat32.hpp"
-#include "memory/heap.hpp"
+#include "memory/scratch.hpp"
 #include "printf.hpp"
 #include "terminal.hpp"
 
@@ -41,7 +41,14 @@ void cmd_cat(const char* path) {
     }
 
     constexpr size_t CHUNK_SIZE = 4096;
-    uint8_t* buffer = new uint8_t[CHUNK_SIZE];
+    ScratchScope scratch;
+    auto* buffer = static_cast<uint8_t*>(scratch.allocate(CHUNK_SIZE));
+    if (!buffer) {
+        printf("cat: memory allocation failed\n");
+        pm.terminate_process(pid);
+        return;
+    }
+
     size_t remaining = size;
     size_t offset = 0;
     bool ends_with_newline = false;
@@ -69,7 +76,6 @@ void cmd_cat(const char* path) {
 
     if (!ends_with_newline) terminal_putchar('\n');
 
-    delete[] buffer;
     pm.terminate_process(pid);
 }
 
@@ -24,6 +24,16 @@ void cmd_ps();
 void cmd_ipc_test();
 void cmd_cores();
 void cmd_alias();
+void cmd_pmm_bench();
+void cmd_slabinfo();
+void cmd_heap_bench();
+void cmd_heap_stress();
+void cmd_heapstat(const char* args);
+void cmd_ctxbench();
+void cmd_forkbench();
+void cmd_tlbbench();
+void cmd_schedbench();
+void cmd_balancesim();
 
 void append_to_history_file(const char* command);
 void load_aliases();
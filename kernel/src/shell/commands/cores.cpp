@@ -6,6 +6,20 @@
 
 namespace commands {
 
+namespace {
+const char* timer_name(const kernel::CPUInfo* cpu_info) {
+    switch (cpu_info->timer_mode) {
+        case kernel::TimerMode::OneShot:
+            return "one-shot";
+        case kernel::TimerMode::TscDeadline:
+            return "deadline";
+        case kernel::TimerMode::None:
+            break;
+    }
+    return cpu_info->is_bsp ? "PIT" : "none";
+}
+}  // namespace
+
 void cmd_cores() {
     auto& pm = kernel::ProcessManager::instance();
     pid_t pid = pm.create_process("cores", shell_pid);
@@ -15,8 +29,8 @@ void cmd_cores() {
     smp.detect_active_cores();
 
     uint32_t cpu_count = smp.get_cpu_count();
-    printf("ID | LAPIC ID | BSP | Active | Stack Address\n");
-    printf("---+---------+-----+--------+-------------\n");
+    printf("ID | LAPIC ID | BSP | Active | Stack Address      | Timer    | Tick  | Timer IRQs\n");
+    printf("---+---------+-----+--------+--------------------+----------+-------+-----------\n");
 
     uint32_t active_count = 0;
     for (uint32_t i = 0; i < cpu_count; i++) {
@@ -27,9 +41,11 @@ void cmd_cores() {
     for (uint32_t i = 0; i < cpu_count; i++) {
         auto* cpu_info = smp.get_cpu_info(i);
         if (cpu_info) {
-            printf("%2u | %7u | %3s | %6s | 0x%016lx\n", cpu_info->id, cpu_info->lapic_id,
-                   cpu_info->is_bsp ? "Yes" : "No", cpu_info->is_active ? "Yes" : "No",
-                   cpu_info->kernel_stack);
+            printf("%2u | %7u | %3s | %6s | 0x%016lx | %-8s | %5s | %10lu\n", cpu_info->id,
+                   cpu_info->lapic_id, cpu_info->is_bsp ? "Yes" : "No",
+                   cpu_info->is_active ? "Yes" : "No", cpu_info->kernel_stack,
+                   timer_name(cpu_info), cpu_info->tick_stopped ? "off" : "on",
+                   cpu_info->timer_interrupts);
         }
     }
 
@@ -0,0 +1,116 @@
+#include "../shell.hpp"
+#include "commands.hpp"
+#include "core/process.hpp"
+#include "lib/spinlock.hpp"
+#include "physical_memory.hpp"
+#include "printf.hpp"
+#include "timer.hpp"
+#include "virtual_memory.hpp"
+
+namespace commands {
+
+namespace {
+constexpr uintptr_t BENCH_BASE = 0x0000008000000000;
+constexpr size_t BENCH_PAGES = 64;
+constexpr size_t BENCH_ROUNDS = 2000;
+
+bool populate(AddressSpace* space) {
+    auto& pmm = PhysicalMemoryManager::instance();
+    auto& vmm = VirtualMemoryManager::instance();
+
+    for (size_t i = 0; i < BENCH_PAGES; i++) {
+        void* frame = pmm.allocate_zeroed_frame();
+        if (!frame) return false;
+
+        vmm.map_page(space, BENCH_BASE + i * PhysicalMemoryManager::PAGE_SIZE,
+                     reinterpret_cast<uintptr_t>(frame), true);
+    }
+
+    return true;
+}
+
+void release(AddressSpace* space) {
+    if (!space) return;
+
+    auto& pmm = PhysicalMemoryManager::instance();
+    auto& vmm = VirtualMemoryManager::instance();
+
+    for (size_t i = 0; i < BENCH_PAGES; i++) {
+        uintptr_t addr = BENCH_BASE + i * PhysicalMemoryManager::PAGE_SIZE;
+        uintptr_t phys = vmm.get_physical_address(space, addr);
+        if (!phys) continue;
+
+        if (vmm.unmap_page(space, addr)) pmm.free_frame(reinterpret_cast<void*>(phys));
+    }
+
+    vmm.destroy_address_space(space);
+}
+
+uint64_t measure(AddressSpace* first, AddressSpace* second, bool flush) {
+    auto& vmm = VirtualMemoryManager::instance();
+    AddressSpace* spaces[] = {first, second};
+
+    uint64_t flags = kernel::Spinlock::save_irq();
+    AddressSpace* previous = vmm.get_active_address_space();
+
+    uint64_t start = read_tsc();
+    for (size_t round = 0; round < BENCH_ROUNDS; round++) {
+        for (AddressSpace* space : spaces) {
+            vmm.activate(space, flush);
+
+            for (size_t i = 0; i < BENCH_PAGES; i++) {
+                auto* page = reinterpret_cast<volatile uint64_t*>(
+                    BENCH_BASE + i * PhysicalMemoryManager::PAGE_SIZE);
+                (void)*page;
+            }
+        }
+    }
+    uint64_t cycles = read_tsc() - start;
+
+    vmm.activate(previous);
+    kernel::Spinlock::restore_irq(flags);
+
+    return cycles / (BENCH_ROUNDS * 2);
+}
+}  // namespace
+
+void cmd_ctxbench() {
+    auto& pm = kernel::ProcessManager::instance();
+    pid_t pid = pm.create_process("ctxbench", shell_pid);
+
+    auto& vmm = VirtualMemoryManager::instance();
+
+    AddressSpace* first = vmm.create_address_space();
+    AddressSpace* second = vmm.create_address_space();
+
+    if (!first || !second || !populate(first) || !populate(second)) {
+        set_red();
+        printf("Error: Failed to set up benchmark address spaces\n");
+        reset_color();
+        release(first);
+        release(second);
+        pm.terminate_process(pid);
+        return;
+    }
+
+    printf("PCID: %s, INVPCID: %s\n", vmm.has_pcid() ? "yes" : "no",
+           vmm.has_invpcid() ? "yes" : "no");
+    printf("Switch + touch %zu pages, %zu round trips\n\n", BENCH_PAGES, BENCH_ROUNDS);
+
+    uint64_t flushed = measure(first, second, true);
+    uint64_t tagged = measure(first, second, false);
+
+    printf("Mode            | cycles/switch\n");
+    printf("----------------+--------------\n");
+    printf("Full TLB flush  | %13lu\n", flushed);
+    printf("PCID (no flush) | %13lu\n", tagged);
+
+    if (!vmm.has_pcid()) printf("\nPCID unsupported: both modes flush the TLB\n");
+
+    release(first);
+    release(second);
+
+    pm.terminate_process(pid);
+}
+
+}  // namespace commands
\ No newline at end of file
@@ -0,0 +1,158 @@
+#include <cstring>
+
+#include "../shell.hpp"
+#include "commands.hpp"
+#include "core/process.hpp"
+#include "lib/spinlock.hpp"
+#include "physical_memory.hpp"
+#include "printf.hpp"
+#include "timer.hpp"
+#include "virtual_memory.hpp"
+
+namespace commands {
+
+namespace {
+constexpr size_t BENCH_ROUNDS = 8;
+constexpr size_t PARENT_SIZES[] = {64 * 1024, 8 * 1024 * 1024};
+
+struct ForkResult {
+    uint64_t eager_cycles = 0;
+    uint64_t cow_cycles = 0;
+    size_t cow_frames = 0;
+};
+
+void touch(kernel::Process* parent, uint64_t start, size_t size) {
+    auto& vmm = VirtualMemoryManager::instance();
+
+    uint64_t flags = kernel::Spinlock::save_irq();
+    AddressSpace* previous = vmm.get_active_address_space();
+    vmm.activate(parent->address_space);
+
+    for (size_t offset = 0; offset < size; offset += PhysicalMemoryManager::PAGE_SIZE)
+        *reinterpret_cast<volatile uint64_t*>(start + offset) = offset;
+
+    vmm.activate(previous);
+    kernel::Spinlock::restore_irq(flags);
+}
+
+bool copy_eagerly(kernel::Process* parent, AddressSpace* child) {
+    auto& pmm = PhysicalMemoryManager::instance();
+    auto& vmm = VirtualMemoryManager::instance();
+
+    for (kernel::MemoryRegion* region = parent->regions.first(); region;
+         region = kernel::RegionTree::next(region)) {
+        for (uint64_t addr = region->start; addr < region->end();
+             addr += PhysicalMemoryManager::PAGE_SIZE) {
+            void* frame = pmm.allocate_frame();
+            if (!frame) return false;
+
+            uintptr_t source = vmm.get_physical_address(parent->address_space, addr);
+            memcpy(phys_to_virt(reinterpret_cast<uintptr_t>(frame)), phys_to_virt(source),
+                   PhysicalMemoryManager::PAGE_SIZE);
+            vmm.map_page(child, addr, reinterpret_cast<uintptr_t>(frame), region->writable);
+        }
+    }
+
+    return true;
+}
+
+void release_eager(kernel::Process* parent, AddressSpace* child) {
+    auto& pmm = PhysicalMemoryManager::instance();
+    auto& vmm = VirtualMemoryManager::instance();
+
+    for (kernel::MemoryRegion* region = parent->regions.first(); region;
+         region = kernel::RegionTree::next(region)) {
+        for (uint64_t addr = region->start; addr < region->end();
+             addr += PhysicalMemoryManager::PAGE_SIZE) {
+            uintptr_t phys = vmm.get_physical_address(child, addr);
+            if (phys) pmm.free_frame(reinterpret_cast<void*>(phys));
+        }
+    }
+
+    vmm.destroy_address_space(child);
+}
+
+bool measure(kernel::Process* parent, ForkResult& result) {
+    auto& pm = kernel::ProcessManager::instance();
+    auto& pmm = PhysicalMemoryManager::instance();
+    auto& vmm = VirtualMemoryManager::instance();
+
+    for (size_t round = 0; round < BENCH_ROUNDS; round++) {
+        AddressSpace* child = vmm.create_address_space();
+        if (!child) return false;
+
+        uint64_t start = read_tsc();
+        bool copied = copy_eagerly(parent, child);
+        result.eager_cycles += read_tsc() - start;
+
+        release_eager(parent, child);
+        if (!copied) return false;
+    }
+
+    for (size_t round = 0; round < BENCH_ROUNDS; round++) {
+        auto* child = new kernel::Process;
+        size_t free_before = pmm.get_free_frames();
+
+        uint64_t start = read_tsc();
+        bool cloned = pm.clone_memory(parent, child);
+        result.cow_cycles += read_tsc() - start;
+
+        result.cow_frames += free_before - pmm.get_free_frames();
+        pm.release_memory(child->address_space, child->regions);
+        delete child;
+        if (!cloned) return false;
+    }
+
+    result.eager_cycles /= BENCH_ROUNDS;
+    result.cow_cycles /= BENCH_ROUNDS;
+    result.cow_frames /= BENCH_ROUNDS;
+    return true;
+}
+}  // namespace
+
+void cmd_forkbench() {
+    auto& pm = kernel::ProcessManager::instance();
+    pid_t pid = pm.create_process("forkbench", shell_pid);
+    kernel::Process* parent = pm.get_process(pid);
+
+    auto& vmm = VirtualMemoryManager::instance();
+    if (parent) parent->address_space = vmm.create_address_space();
+
+    if (!parent || !parent->address_space) {
+        set_red();
+        printf("Error: Failed to set up benchmark parent\n");
+        reset_color();
+        pm.terminate_process(pid);
+        return;
+    }
+
+    printf("Fork latency, %zu rounds per mode\n\n", BENCH_ROUNDS);
+    printf("Parent RSS | eager cycles |  COW cycles | speedup | COW frames\n");
+    printf("-----------+--------------+-------------+---------+-----------\n");
+
+    size_t resident = 0;
+    for (size_t size : PARENT_SIZES) {
+        uint64_t start = pm.map_anonymous(parent, 0, size - resident, true, false, false);
+        if (!start) break;
+
+        touch(parent, start, size - resident);
+        resident = size;
+
+        ForkResult result;
+        if (!measure(parent, result)) {
+            set_red();
+            printf("Error: Out of memory at %zu KiB\n", size / 1024);
+            reset_color();
+            break;
+        }
+
+        uint64_t speedup = result.cow_cycles ? result.eager_cycles * 10 / result.cow_cycles : 0;
+        printf("%6zu KiB | %12lu | %11lu | %5lu.%lux | %10zu\n", size / 1024,
+               result.eager_cycles, result.cow_cycles, speedup / 10, speedup % 10,
+               result.cow_frames);
+    }
+
+    pm.terminate_process(pid);
+}
+
+}  // namespace commands
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "../shell.hpp"
+#include "commands.hpp"
+#include "core/process.hpp"
+#include "heap.hpp"
+#include "printf.hpp"
+#include "timer.hpp"
+
+namespace commands {
+
+namespace {
+constexpr size_t BENCH_SLOTS = 512;
+constexpr size_t BENCH_OPS = 100000;
+
+uint64_t next_random(uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+size_t random_size(uint64_t& state) {
+    uint64_t value = next_random(state);
+    switch (value % 8) {
+        case 0:
+            return 1024 + (value >> 8) % 7168;
+        case 1:
+        case 2:
+            return 128 + (value >> 8) % 896;
+        default:
+            return 8 + (value >> 8) % 120;
+    }
+}
+}  // namespace
+
+void cmd_heap_bench() {
+    auto& pm = kernel::ProcessManager::instance();
+    pid_t pid = pm.create_process("heapbench", shell_pid);
+
+    auto& heap = HeapAllocator::instance();
+    void* slots[BENCH_SLOTS] = {};
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+
+    uint64_t alloc_cycles = 0;
+    uint64_t free_cycles = 0;
+    size_t allocs = 0;
+    size_t frees = 0;
+    size_t failures = 0;
+    size_t free_before = heap.get_free_memory();
+
+    for (size_t op = 0; op < BENCH_OPS; op++) {
+        size_t slot = next_random(state) % BENCH_SLOTS;
+
+        if (slots[slot]) {
+            uint64_t start = read_tsc();
+            heap.free(slots[slot]);
+            free_cycles += read_tsc() - start;
+            slots[slot] = nullptr;
+            frees++;
+        } else {
+            size_t size = random_size(state);
+            uint64_t start = read_tsc();
+            slots[slot] = heap.allocate(size);
+            alloc_cycles += read_tsc() - start;
+            if (slots[slot])
+                allocs++;
+            else
+                failures++;
+        }
+    }
+
+    size_t free_peak = heap.get_free_memory();
+
+    for (size_t i = 0; i < BENCH_SLOTS; i++) {
+        heap.free(slots[i]);
+    }
+
+    printf("Mixed-size churn: %zu ops over %zu live slots\n", BENCH_OPS, BENCH_SLOTS);
+    printf("allocate: %zu calls, %lu cycles avg\n", allocs, allocs ? alloc_cycles / allocs : 0);
+    printf("free:     %zu calls, %lu cycles avg\n", frees, frees ? free_cycles / frees : 0);
+    printf("failed allocations: %zu\n", failures);
+    printf("heap free: %zu KB before, %zu KB at end of churn, %zu KB after cleanup\n",
+           free_before / 1024, free_peak / 1024, heap.get_free_memory() / 1024);
+
+    pm.terminate_process(pid);
+}
+
+}  // namespace commands
\ No newline at end of file
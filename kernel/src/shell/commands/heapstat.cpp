@@ -0,0 +1,40 @@
+#include <cstring>
+
+#include "../shell.hpp"
+#include "commands.hpp"
+#include "core/process.hpp"
+#include "heap_profiler.hpp"
+#include "printf.hpp"
+#include "serial.hpp"
+#include "terminal.hpp"
+
+namespace commands {
+
+void cmd_heapstat(const char* args) {
+    auto& pm = kernel::ProcessManager::instance();
+    pid_t pid = pm.create_process("heapstat", shell_pid);
+
+    auto& profiler = HeapProfiler::instance();
+
+    if (!args || !*args)
+        profiler.report(terminal_putchar);
+    else if (strcmp(args, "on") == 0) {
+        profiler.reset();
+        profiler.set_enabled(true);
+        printf("heapstat: profiling enabled\n");
+    } else if (strcmp(args, "off") == 0) {
+        profiler.set_enabled(false);
+        printf("heapstat: profiling disabled\n");
+    } else if (strcmp(args, "reset") == 0) {
+        profiler.reset();
+        printf("heapstat: counters reset\n");
+    } else if (strcmp(args, "serial") == 0) {
+        profiler.report(serial_putchar);
+        printf("heapstat: report written to COM1\n");
+    } else
+        printf("heapstat: usage: heapstat [on|off|reset|serial]\n");
+
+    pm.terminate_process(pid);
+}
+
+}  // namespace commands
\ No newline at end of file
@@ -0,0 +1,156 @@
+#include "../shell.hpp"
+#include "commands.hpp"
+#include "core/process.hpp"
+#include "heap.hpp"
+#include "hw/smp.hpp"
+#include "printf.hpp"
+#include "timer.hpp"
+
+namespace commands {
+
+namespace {
+constexpr size_t STRESS_BATCH = 256;
+constexpr size_t STRESS_ROUNDS = 64;
+
+struct StressWorker {
+    uint32_t cpu_id = 0;
+    size_t index = 0;
+    uint64_t cycles = 0;
+    size_t failures = 0;
+    void* slots[STRESS_BATCH] = {};
+};
+
+struct StressRun {
+    StressWorker workers[kernel::MAX_CPUS];
+    size_t worker_count = 0;
+    volatile uint32_t arrived = 0;
+    volatile uint32_t generation = 0;
+    volatile bool started = false;
+};
+
+StressRun g_run;
+
+void barrier(StressRun& run) {
+    uint32_t generation = __atomic_load_n(&run.generation, __ATOMIC_ACQUIRE);
+
+    if (__atomic_add_fetch(&run.arrived, 1, __ATOMIC_ACQ_REL) == run.worker_count) {
+        __atomic_store_n(&run.arrived, 0, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&run.generation, 1, __ATOMIC_RELEASE);
+        return;
+    }
+
+    while (__atomic_load_n(&run.generation, __ATOMIC_ACQUIRE) == generation)
+        asm volatile("pause");
+}
+
+void stress_worker(void* arg) {
+    auto* worker = static_cast<StressWorker*>(arg);
+    auto& heap = HeapAllocator::instance();
+
+    while (!__atomic_load_n(&g_run.started, __ATOMIC_ACQUIRE))
+        asm volatile("pause");
+
+    StressWorker& victim = g_run.workers[(worker->index + 1) % g_run.worker_count];
+    uint64_t seed = worker->index * 0x9E3779B97F4A7C15ULL + 1;
+
+    barrier(g_run);
+    uint64_t start = read_tsc();
+
+    for (size_t round = 0; round < STRESS_ROUNDS; round++) {
+        for (size_t i = 0; i < STRESS_BATCH; i++) {
+            seed ^= seed << 13;
+            seed ^= seed >> 7;
+            seed ^= seed << 17;
+            worker->slots[i] = heap.allocate(16 + seed % 496);
+            if (!worker->slots[i]) worker->failures++;
+        }
+
+        barrier(g_run);
+
+        for (size_t i = 0; i < STRESS_BATCH; i++) {
+            heap.free(victim.slots[i]);
+            victim.slots[i] = nullptr;
+        }
+
+        barrier(g_run);
+    }
+
+    worker->cycles = read_tsc() - start;
+}
+}  // namespace
+
+void cmd_heap_stress() {
+    auto& pm = kernel::ProcessManager::instance();
+    pid_t pid = pm.create_process("heapstress", shell_pid);
+
+    auto& smp = kernel::SMPManager::instance();
+    uint32_t self = smp.get_current_cpu_id();
+
+    uint32_t cpus[kernel::MAX_CPUS];
+    size_t cpu_count = 0;
+    cpus[cpu_count++] = self;
+
+    for (uint32_t i = 0; i < smp.get_cpu_count() && cpu_count < kernel::MAX_CPUS; i++) {
+        auto* cpu = smp.get_cpu_info(i);
+        if (cpu && cpu->is_active && !cpu->is_bsp && cpu->id != self) cpus[cpu_count++] = cpu->id;
+    }
+
+    printf("CPUs | alloc+free ops | cycles (max) | ops/Kcycle | failures\n");
+    printf("-----+----------------+--------------+------------+---------\n");
+
+    for (size_t workers = 1; workers <= cpu_count; workers++) {
+        g_run.worker_count = workers;
+        g_run.arrived = 0;
+        g_run.started = false;
+
+        for (size_t i = 0; i < workers; i++) {
+            g_run.workers[i] = StressWorker{};
+            g_run.workers[i].cpu_id = cpus[i];
+            g_run.workers[i].index = i;
+        }
+
+        size_t launched = 1;
+        while (launched < workers &&
+               smp.run_on_cpu(cpus[launched], stress_worker, &g_run.workers[launched]))
+            launched++;
+
+        if (launched != workers) {
+            set_red();
+            printf("Error: CPU %u is busy\n", cpus[launched]);
+            reset_color();
+            g_run.worker_count = launched;
+        }
+
+        __atomic_store_n(&g_run.started, true, __ATOMIC_RELEASE);
+        stress_worker(&g_run.workers[0]);
+
+        uint64_t cycles = 0;
+        size_t failures = 0;
+        for (size_t i = 0; i < g_run.worker_count; i++) {
+            if (i > 0) smp.wait_for_cpu(cpus[i]);
+            if (g_run.workers[i].cycles > cycles) cycles = g_run.workers[i].cycles;
+            failures += g_run.workers[i].failures;
+        }
+
+        size_t ops = g_run.worker_count * STRESS_ROUNDS * STRESS_BATCH * 2;
+        printf("%4zu | %14zu | %12lu | %10lu | %8zu\n", g_run.worker_count, ops, cycles,
+               cycles ? ops * 1000 / cycles : 0, failures);
+
+        if (launched != workers) break;
+    }
+
+    printf("\nArena | Chunks | Allocs | Frees | Remote frees\n");
+    printf("------+--------+--------+-------+-------------\n");
+
+    auto& heap = HeapAllocator::instance();
+    for (size_t i = 0; i < HeapAllocator::MAX_ARENAS; i++) {
+        const auto& stats = heap.get_arena(i).get_stats();
+        if (!stats.chunks) continue;
+        printf("%5zu | %6zu | %6lu | %5lu | %12lu\n", i, stats.chunks, stats.allocations,
+               stats.frees, stats.remote_frees);
+    }
+
+    pm.terminate_process(pid);
+}
+
+}  // namespace commands
\ No newline at end of file
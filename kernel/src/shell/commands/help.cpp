@@ -9,27 +9,37 @@ void cmd_help() {
     auto& pm = kernel::ProcessManager::instance();
     pid_t pid = pm.create_process("help", shell_pid);
     const char* help_text = "Available commands:\n\n"
-                            "  help     - Display this help message\n"
-                            "  echo     - Echo arguments\n"
-                            "  clear    - Clear the screen\n"
-                            "  crash    - Trigger a kernel panic (for testing)\n"
-                            "  shutdown - Power off the system\n"
-                            "  memory   - Display memory usage information\n"
-                            "  ls       - List directory contents\n"
-                            "  mkdir    - Create a new directory\n"
-                            "  cd       - Change current directory\n"
-                            "  cat      - Display file contents\n"
-                            "  mv       - Move or rename a file\n"
-                            "  rm       - Remove a file or directory\n"
-                            "  touch    - Create an empty file\n"
-                            "  edit     - Edit a file\n"
-                            "  history  - Display command history\n"
-                            "  uptime   - Display system uptime\n"
-                            "  time     - Display system time\n"
-                            "  ps       - List running processes\n"
-                            "  pkill    - Kill a process\n"
-                            "  ipctest  - Run IPC test\n"
-                            "  cores    - List CPU cores\n";
+                            "  help       - Display this help message\n"
+                            "  echo       - Echo arguments\n"
+                            "  clear      - Clear the screen\n"
+                            "  crash      - Trigger a kernel panic (for testing)\n"
+                            "  shutdown   - Power off the system\n"
+                            "  memory     - Display memory usage information\n"
+                            "  ls         - List directory contents\n"
+                            "  mkdir      - Create a new directory\n"
+                            "  cd         - Change current directory\n"
+                            "  cat        - Display file contents\n"
+                            "  mv         - Move or rename a file\n"
+                            "  rm         - Remove a file or directory\n"
+                            "  touch      - Create an empty file\n"
+                            "  edit       - Edit a file\n"
+                            "  history    - Display command history\n"
+                            "  uptime     - Display system uptime\n"
+                            "  time       - Display system time\n"
+                            "  ps         - List running processes\n"
+                            "  pkill      - Kill a process\n"
+                            "  ipctest    - Run IPC test\n"
+                            "  cores      - List CPU cores\n"
+                            "  pmmbench   - Benchmark physical frame allocation\n"
+                            "  slabinfo   - List slab cache usage\n"
+                            "  heapbench  - Benchmark heap allocation churn\n"
+                            "  heapstress - Multi-core heap alloc/free stress test\n"
+                            "  heapstat   - Show heap allocation profile\n"
+                            "  ctxbench   - Benchmark address space switches with/without PCID\n"
+                            "  forkbench  - Measure fork latency with and without copy-on-write\n"
+                            "  tlbbench   - Benchmark kernel TLB misses with/without global pages\n"
+                            "  schedbench - Compare scheduler fairness and wakeup latency\n"
+                            "  balancesim - Simulate load balancing across 1-8 vCPUs\n";
 
     pager::show_text(help_text);
 
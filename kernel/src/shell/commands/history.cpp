@@ -2,6 +2,7 @@
 #include "commands.hpp"
 #include "core/process.hpp"
 #include "fs/fat32.hpp"
+#include "memory/scratch.hpp"
 #include "printf.hpp"
 
 namespace commands {
@@ -17,13 +18,17 @@ void append_to_history_file(const char* command) {
     if (!fs.findFile("/shell/history", file_cluster, size, attributes))
         fs.createFileWithContent("/shell/history", nullptr, 0, 0);
 
-    uint8_t buffer[4096] = {0};
-    fs.readFileByPath("/shell/history", buffer, sizeof(buffer) - 1);
+    constexpr size_t BUFFER_SIZE = 4096;
+    ScratchScope scratch;
+    auto* buffer = static_cast<uint8_t*>(scratch.allocate_zeroed(BUFFER_SIZE));
+    if (!buffer) return;
+
+    fs.readFileByPath("/shell/history", buffer, BUFFER_SIZE - 1);
 
     size_t current_length = strlen(reinterpret_cast<const char*>(buffer));
     size_t command_length = strlen(command);
 
-    if (current_length + command_length + 2 < sizeof(buffer)) {
+    if (current_length + command_length + 2 < BUFFER_SIZE) {
         memcpy(buffer + current_length, command, command_length);
         buffer[current_length + command_length] = '\n';
         buffer[current_length + command_length + 1] = '\0';
@@ -42,8 +47,11 @@ void cmd_history() {
     uint8_t attributes;
 
     if (fs.findFile("/shell/history", cluster, size, attributes)) {
-        uint8_t file_buffer[4096] = {0};
-        if (fs.readFileByPath("/shell/history", file_buffer, sizeof(file_buffer) - 1)) {
+        constexpr size_t BUFFER_SIZE = 4096;
+        ScratchScope scratch;
+        auto* file_buffer = static_cast<uint8_t*>(scratch.allocate_zeroed(BUFFER_SIZE));
+
+        if (file_buffer && fs.readFileByPath("/shell/history", file_buffer, BUFFER_SIZE - 1)) {
             char* content = reinterpret_cast<char*>(file_buffer);
             char* line_start = content;
             char* line_end;
@@ -2,7 +2,7 @@
 #include "commands.hpp"
 #include "core/process.hpp"
 #include "fs/fat32.hpp"
-#include "memory/heap.hpp"
+#include "memory/scratch.hpp"
 #include "pager.hpp"
 #include "printf.hpp"
 
@@ -37,7 +37,8 @@ void cmd_less(const char* path) {
             uint32_t cluster = (entry[26] | (entry[27] << 8));
             uint32_t size = (entry[28] | (entry[29] << 8) | (entry[30] << 16) | (entry[31] << 24));
 
-            char* text = new char[size + 1];
+            ScratchScope scratch;
+            auto* text = static_cast<char*>(scratch.allocate(size + 1));
             if (!text) {
                 printf("less: memory allocation failed\n");
                 pm.terminate_process(pid);
@@ -47,7 +48,6 @@ void cmd_less(const char* path) {
             fs.readFile(cluster, reinterpret_cast<uint8_t*>(text), size);
             text[size] = '\0';
             pager::show_text(text);
-            delete[] text;
             break;
         }
     }
@@ -1,8 +1,11 @@
 #include "../shell.hpp"
 #include "commands.hpp"
 #include "core/process.hpp"
+#include "heap.hpp"
+#include "hw/smp.hpp"
 #include "physical_memory.hpp"
 #include "printf.hpp"
+#include "tlb.hpp"
 
 namespace commands {
 
@@ -43,6 +46,42 @@ void cmd_memory() {
 
     printf("%.2f MB used of available %.2f MB\n", used_mb, total_mb);
 
+    printf("\nZone |              Start |                End |     Size\n");
+    printf("-----+--------------------+--------------------+---------\n");
+
+    for (size_t i = 0; i < pmm.get_zone_count(); i++) {
+        const auto& zone = pmm.get_zone(i);
+        printf("%4zu | 0x%016lx | 0x%016lx | %5zu MB\n", i, zone.start, zone.start + zone.size,
+               zone.size / bytes_per_mb);
+    }
+
+    auto& heap = HeapAllocator::instance();
+    printf("Heap: %zu KB mapped, %zu KB in use\n", heap.get_mapped_bytes() / 1024,
+           heap.get_used_memory() / 1024);
+
+    const auto& zero_stats = pmm.get_zero_pool_stats();
+    printf("\nZeroed pool: %zu frames ready, %lu pre-zeroed\n", pmm.get_zeroed_frames(),
+           zero_stats.prezeroed);
+    printf("Zeroed frames: %lu from pool, %lu zeroed on demand\n", zero_stats.pool_hits,
+           zero_stats.zeroed_on_demand);
+
+    const auto& tlb_stats = TLBShootdown::instance().get_stats();
+    printf("TLB shootdowns: %lu (%lu pages, %lu full flushes), %lu IPIs\n", tlb_stats.shootdowns,
+           tlb_stats.pages, tlb_stats.full_flushes, tlb_stats.ipis);
+
+    auto& smp = kernel::SMPManager::instance();
+    uint32_t cpu_count = smp.get_cpu_count();
+    if (cpu_count > kernel::MAX_CPUS) cpu_count = kernel::MAX_CPUS;
+
+    printf("\nCPU | Cached |       Hits |   Misses |  Refills |   Drains\n");
+    printf("----+--------+------------+----------+----------+---------\n");
+
+    for (uint32_t cpu = 0; cpu < cpu_count; cpu++) {
+        const auto& stats = pmm.get_cache_stats(cpu);
+        printf("%3u | %6zu | %10lu | %8lu | %8lu | %8lu\n", cpu, pmm.get_cached_frames(cpu),
+               stats.hits, stats.misses, stats.refills, stats.drains);
+    }
+
     pm.terminate_process(pid);
 }
 
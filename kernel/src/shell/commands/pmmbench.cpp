@@ -0,0 +1,102 @@
+#include "../shell.hpp"
+#include "commands.hpp"
+#include "core/process.hpp"
+#include "physical_memory.hpp"
+#include "printf.hpp"
+#include "timer.hpp"
+#include "virtual_memory.hpp"
+
+namespace commands {
+
+namespace {
+constexpr size_t BENCH_BATCH = 256;
+constexpr size_t BENCH_ROUNDS = 16;
+constexpr size_t BENCH_ORDER = 4;
+
+void measure(size_t order, size_t batch, uint64_t& alloc_cycles, uint64_t& free_cycles) {
+    auto& pmm = PhysicalMemoryManager::instance();
+    void* frames[BENCH_BATCH];
+    uint64_t total_alloc = 0;
+    uint64_t total_free = 0;
+    size_t samples = 0;
+
+    for (size_t round = 0; round < BENCH_ROUNDS; round++) {
+        size_t count = 0;
+
+        uint64_t start = read_tsc();
+        for (size_t i = 0; i < batch; i++) {
+            frames[i] = pmm.allocate_frames(order);
+            if (!frames[i]) break;
+            count++;
+        }
+        total_alloc += read_tsc() - start;
+
+        start = read_tsc();
+        for (size_t i = 0; i < count; i++) {
+            pmm.free_frames(frames[i], order);
+        }
+        total_free += read_tsc() - start;
+
+        samples += count;
+    }
+
+    alloc_cycles = samples ? total_alloc / samples : 0;
+    free_cycles = samples ? total_free / samples : 0;
+}
+}  // namespace
+
+void cmd_pmm_bench() {
+    auto& pm = kernel::ProcessManager::instance();
+    pid_t pid = pm.create_process("pmmbench", shell_pid);
+
+    auto& pmm = PhysicalMemoryManager::instance();
+
+    size_t allocatable = pmm.get_free_frames();
+    if (allocatable <= 2 * BENCH_BATCH) {
+        set_red();
+        printf("Error: Not enough free memory to run benchmark\n");
+        reset_color();
+        pm.terminate_process(pid);
+        return;
+    }
+
+    uintptr_t held = 0;
+    size_t held_count = 0;
+
+    printf("Pressure | alloc (cyc) | free (cyc) | order-%zu alloc | order-%zu free\n", BENCH_ORDER,
+           BENCH_ORDER);
+    printf("---------+-------------+------------+---------------+--------------\n");
+
+    const size_t pressures[] = {10, 50, 90};
+    for (size_t pressure : pressures) {
+        size_t target = allocatable * pressure / 100;
+        if (target > allocatable - BENCH_BATCH) target = allocatable - BENCH_BATCH;
+
+        while (held_count < target) {
+            void* frame = pmm.allocate_frame();
+            if (!frame) break;
+
+            *phys_to_virt<uintptr_t>(reinterpret_cast<uintptr_t>(frame)) = held;
+            held = reinterpret_cast<uintptr_t>(frame);
+            held_count++;
+        }
+
+        uint64_t alloc_cycles, free_cycles, order_alloc_cycles, order_free_cycles;
+        measure(0, BENCH_BATCH, alloc_cycles, free_cycles);
+        measure(BENCH_ORDER, BENCH_BATCH / (1 << BENCH_ORDER), order_alloc_cycles,
+                order_free_cycles);
+
+        printf("%7zu%% | %11lu | %10lu | %13lu | %12lu\n", pressure, alloc_cycles, free_cycles,
+               order_alloc_cycles, order_free_cycles);
+    }
+
+    while (held) {
+        uintptr_t next = *phys_to_virt<uintptr_t>(held);
+        pmm.free_frame(reinterpret_cast<void*>(held));
+        held = next;
+    }
+
+    pm.terminate_process(pid);
+}
+
+}  // namespace commands
\ No newline at end of file
@@ -9,7 +9,7 @@ void cmd_ps() {
     auto& pm = kernel::ProcessManager::instance();
     pid_t pid = pm.create_process("ps", shell_pid);
 
-    printf("  PID  PPID  STATE    NAME\n");
+    printf("  PID  PPID  STATE       RSS(K)    VSZ(K)  NAME\n");
 
     kernel::Process* current = pm.get_first_process();
     while (current) {
@@ -33,6 +33,7 @@ void cmd_ps() {
                 break;
         }
 
+        printf("%9lu %9lu  ", current->resident_pages * 4, pm.get_virtual_size(current) / 1024);
         printf(current->name);
         printf("\n");
 
@@ -0,0 +1,173 @@
+#include "../shell.hpp"
+#include "commands.hpp"
+#include "core/process.hpp"
+#include "core/scheduler.hpp"
+#include "printf.hpp"
+#include "sim_processes.hpp"
+
+namespace commands {
+
+namespace {
+constexpr uint64_t SIM_TICKS = 20000;
+constexpr size_t HOG_COUNT = 3;
+constexpr size_t INTERACTIVE_COUNT = 3;
+constexpr size_t TASK_COUNT = HOG_COUNT + INTERACTIVE_COUNT;
+constexpr uint8_t HOG_PRIORITIES[HOG_COUNT] = {9, 5, 5};
+constexpr uint8_t INTERACTIVE_PRIORITY = 5;
+constexpr uint64_t INTERACTIVE_BURST = 1;
+constexpr uint64_t INTERACTIVE_SLEEP = 4;
+constexpr size_t LATENCY_BUCKETS = 64;
+
+struct SimTask {
+    bool interactive = false;
+    uint64_t ran = 0;
+    uint64_t served = 0;
+    uint64_t burst_left = 0;
+    uint64_t wake_at = 0;
+    uint64_t woke_at = 0;
+    bool pending = false;
+};
+
+struct SimResult {
+    uint64_t high_hog_ticks = 0;
+    uint64_t hog_ticks = 0;
+    uint64_t interactive_ticks = 0;
+    uint64_t served = 0;
+    uint64_t starved = 0;
+    uint64_t p99_latency = 0;
+    uint64_t max_latency = 0;
+};
+
+void record_pick(SimTask* tasks, kernel::Process* process, uint64_t now, uint64_t* histogram,
+                 SimResult& result) {
+    SimTask& task = tasks[SimProcesses::index_of(process)];
+    if (!task.pending) return;
+
+    uint64_t latency = now - task.woke_at;
+    task.pending = false;
+    task.served++;
+    task.burst_left = INTERACTIVE_BURST;
+    histogram[latency < LATENCY_BUCKETS ? latency : LATENCY_BUCKETS - 1]++;
+    if (latency > result.max_latency) result.max_latency = latency;
+    result.served++;
+}
+
+bool simulate(kernel::SchedulerPolicy policy, SimResult& result) {
+    auto& scheduler = kernel::Scheduler::instance();
+
+    SimProcesses processes(TASK_COUNT);
+    if (!processes.valid()) return false;
+
+    auto* runqueue = new kernel::CPURunQueue;
+    runqueue->policy = policy;
+
+    SimTask tasks[TASK_COUNT];
+    uint64_t histogram[LATENCY_BUCKETS] = {};
+
+    for (size_t i = 0; i < TASK_COUNT; i++) {
+        tasks[i].interactive = i >= HOG_COUNT;
+        processes[i]->priority = tasks[i].interactive ? INTERACTIVE_PRIORITY : HOG_PRIORITIES[i];
+        tasks[i].pending = tasks[i].interactive;
+        scheduler.wake_process(runqueue, processes[i]);
+    }
+
+    for (uint64_t now = 0; now < SIM_TICKS; now++) {
+        for (size_t i = 0; i < TASK_COUNT; i++) {
+            SimTask& task = tasks[i];
+            if (!task.interactive || task.pending || task.wake_at != now || !now) continue;
+
+            task.pending = true;
+            task.woke_at = now;
+            scheduler.wake_process(runqueue, processes[i]);
+        }
+
+        if (!runqueue->current || runqueue->needs_resched) {
+            kernel::Process* picked = scheduler.pick_next_process(runqueue);
+            if (picked) record_pick(tasks, picked, now, histogram, result);
+        }
+
+        kernel::Process* current = runqueue->current;
+        if (!current) continue;
+
+        SimTask& task = tasks[SimProcesses::index_of(current)];
+        task.ran++;
+
+        bool resched = scheduler.account_tick(runqueue);
+        if (task.interactive && task.burst_left && --task.burst_left == 0) {
+            current->state = kernel::ProcessState::Waiting;
+            task.wake_at = now + INTERACTIVE_SLEEP;
+            resched = true;
+        }
+
+        if (resched) {
+            kernel::Process* picked = scheduler.pick_next_process(runqueue);
+            if (picked) record_pick(tasks, picked, now + 1, histogram, result);
+        }
+    }
+
+    for (size_t i = 0; i < TASK_COUNT; i++) {
+        if (tasks[i].interactive) {
+            result.interactive_ticks += tasks[i].ran;
+            if (!tasks[i].served) result.starved++;
+        } else if (HOG_PRIORITIES[i] >= 9)
+            result.high_hog_ticks += tasks[i].ran;
+        else
+            result.hog_ticks += tasks[i].ran;
+    }
+    delete runqueue;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < LATENCY_BUCKETS && result.served; i++) {
+        seen += histogram[i];
+        if (seen * 100 >= result.served * 99) {
+            result.p99_latency = i;
+            break;
+        }
+    }
+
+    return true;
+}
+
+uint64_t percent(uint64_t ticks) {
+    return ticks * 100 / SIM_TICKS;
+}
+}  // namespace
+
+void cmd_schedbench() {
+    auto& pm = kernel::ProcessManager::instance();
+    pid_t pid = pm.create_process("schedbench", shell_pid);
+
+    printf("Simulated %lu ticks: 1 hog at priority 9, %zu hogs and %zu interactive tasks\n",
+           SIM_TICKS, HOG_COUNT - 1, INTERACTIVE_COUNT);
+    printf("at priority 5 (interactive: run %lu tick, sleep %lu ticks)\n\n", INTERACTIVE_BURST,
+           INTERACTIVE_SLEEP);
+
+    printf("Policy      | prio-9 hog | prio-5 hogs | interactive | p99 lat | max lat | starved\n");
+    printf("------------+------------+-------------+-------------+---------+---------+--------\n");
+
+    const kernel::SchedulerPolicy policies[] = {kernel::SchedulerPolicy::RoundRobin,
+                                                kernel::SchedulerPolicy::Priority,
+                                                kernel::SchedulerPolicy::Fair};
+    const char* names[] = {"Round-robin", "Priority", "Fair"};
+
+    for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+        SimResult result;
+        if (!simulate(policies[i], result)) {
+            set_red();
+            printf("Error: Failed to allocate simulated tasks\n");
+            reset_color();
+            break;
+        }
+
+        printf("%-11s | %9lu%% | %10lu%% | %10lu%% | %7lu | %7lu | %7lu\n", names[i],
+               percent(result.high_hog_ticks), percent(result.hog_ticks),
+               percent(result.interactive_ticks), result.p99_latency, result.max_latency,
+               result.starved);
+    }
+
+    printf("\nLatency is wakeup-to-run delay in ticks\n");
+
+    pm.terminate_process(pid);
+}
+
+}  // namespace commands
\ No newline at end of file
@@ -0,0 +1,23 @@
+#include "sim_processes.hpp"
+
+namespace commands {
+
+SimProcesses::SimProcesses(size_t count) {
+    if (count > MAX_PROCESSES) return;
+
+    for (; m_count < count; m_count++) {
+        m_processes[m_count] = new kernel::Process;
+        if (!m_processes[m_count]) return;
+
+        m_processes[m_count]->pid = static_cast<kernel::pid_t>(-1 - m_count);
+    }
+
+    m_valid = true;
+}
+
+SimProcesses::~SimProcesses() {
+    for (size_t i = 0; i < m_count; i++)
+        delete m_processes[i];
+}
+
+}  // namespace commands
\ No newline at end of file
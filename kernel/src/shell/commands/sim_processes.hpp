@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+
+#include "core/process.hpp"
+
+namespace commands {
+
+// Detached processes for scheduler simulations. Process i gets pid -1 - i, so a picked process
+// maps straight back to the simulation's own per-task state.
+class SimProcesses {
+public:
+    static constexpr size_t MAX_PROCESSES = 16;
+
+    explicit SimProcesses(size_t count);
+    ~SimProcesses();
+
+    SimProcesses(const SimProcesses&) = delete;
+    SimProcesses& operator=(const SimProcesses&) = delete;
+
+    bool valid() const {
+        return m_valid;
+    }
+    kernel::Process* operator[](size_t index) const {
+        return m_processes[index];
+    }
+
+    static size_t index_of(const kernel::Process* process) {
+        return static_cast<size_t>(-1 - process->pid);
+    }
+
+private:
+    kernel::Process* m_processes[MAX_PROCESSES] = {};
+    size_t m_count = 0;
+    bool m_valid = false;
+};
+
+}  // namespace commands
\ No newline at end of file
@@ -0,0 +1,28 @@
+#include "../shell.hpp"
+#include "commands.hpp"
+#include "core/process.hpp"
+#include "printf.hpp"
+#include "slab.hpp"
+
+namespace commands {
+
+void cmd_slabinfo() {
+    auto& pm = kernel::ProcessManager::instance();
+    pid_t pid = pm.create_process("slabinfo", shell_pid);
+
+    auto& slab = SlabAllocator::instance();
+
+    printf("Cache            |   Active |    Total | Obj size | Slabs | Pages/slab\n");
+    printf("-----------------+----------+----------+----------+-------+-----------\n");
+
+    for (size_t i = 0; i < slab.get_cache_count(); i++) {
+        const auto& cache = slab.get_cache(i);
+        printf("%-16s | %8zu | %8zu | %8zu | %5zu | %10zu\n", cache.get_name(),
+               cache.get_active_objects(), cache.get_total_objects(), cache.get_object_size(),
+               cache.get_slab_count(), cache.get_pages_per_slab());
+    }
+
+    pm.terminate_process(pid);
+}
+
+}  // namespace commands
\ No newline at end of file
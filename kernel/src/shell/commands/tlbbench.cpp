@@ -0,0 +1,96 @@
+#include "../shell.hpp"
+#include "commands.hpp"
+#include "core/process.hpp"
+#include "lib/spinlock.hpp"
+#include "physical_memory.hpp"
+#include "printf.hpp"
+#include "timer.hpp"
+#include "virtual_memory.hpp"
+
+namespace commands {
+
+namespace {
+constexpr size_t BENCH_PAGES = 128;
+constexpr size_t BENCH_ROUNDS = 2000;
+constexpr bool FLUSH_MODES[] = {true, false};
+
+uint64_t measure(AddressSpace* first, AddressSpace* second, const uint8_t* buffer, bool global,
+                 bool flush) {
+    auto& vmm = VirtualMemoryManager::instance();
+    AddressSpace* spaces[] = {first, second};
+
+    uint64_t flags = kernel::Spinlock::save_irq();
+    AddressSpace* previous = vmm.get_active_address_space();
+    vmm.set_global_pages(global);
+
+    uint64_t start = read_tsc();
+    for (size_t round = 0; round < BENCH_ROUNDS; round++) {
+        for (AddressSpace* space : spaces) {
+            vmm.activate(space, flush);
+
+            for (size_t i = 0; i < BENCH_PAGES; i++) {
+                auto* page = reinterpret_cast<const volatile uint8_t*>(
+                    buffer + i * PhysicalMemoryManager::PAGE_SIZE);
+                (void)*page;
+            }
+        }
+    }
+    uint64_t cycles = read_tsc() - start;
+
+    vmm.set_global_pages(true);
+    vmm.activate(previous);
+    kernel::Spinlock::restore_irq(flags);
+
+    return cycles / (BENCH_ROUNDS * 2);
+}
+}  // namespace
+
+void cmd_tlbbench() {
+    auto& pm = kernel::ProcessManager::instance();
+    pid_t pid = pm.create_process("tlbbench", shell_pid);
+
+    auto& vmm = VirtualMemoryManager::instance();
+
+    AddressSpace* first = vmm.create_address_space();
+    AddressSpace* second = vmm.create_address_space();
+    auto* buffer = new uint8_t[BENCH_PAGES * PhysicalMemoryManager::PAGE_SIZE];
+
+    if (!first || !second || !buffer) {
+        set_red();
+        printf("Error: Failed to set up benchmark address spaces\n");
+        reset_color();
+        delete[] buffer;
+        vmm.destroy_address_space(first);
+        vmm.destroy_address_space(second);
+        pm.terminate_process(pid);
+        return;
+    }
+
+    for (size_t i = 0; i < BENCH_PAGES; i++)
+        buffer[i * PhysicalMemoryManager::PAGE_SIZE] = static_cast<uint8_t>(i);
+
+    printf("PGE: %s, PCID: %s\n", vmm.has_global_pages() ? "yes" : "no",
+           vmm.has_pcid() ? "yes" : "no");
+    printf("Switch + touch %zu kernel heap pages, %zu round trips\n\n", BENCH_PAGES,
+           BENCH_ROUNDS);
+
+    printf("Switch mode     | non-global cycles | global cycles\n");
+    printf("----------------+-------------------+--------------\n");
+
+    for (bool flush : FLUSH_MODES) {
+        uint64_t local = measure(first, second, buffer, false, flush);
+        uint64_t global = measure(first, second, buffer, true, flush);
+        printf("%-15s | %17lu | %13lu\n", flush ? "Full TLB flush" : "PCID (no flush)", local,
+               global);
+    }
+
+    if (!vmm.has_global_pages()) printf("\nPGE unsupported: kernel mappings are never global\n");
+
+    delete[] buffer;
+    vmm.destroy_address_space(first);
+    vmm.destroy_address_space(second);
+
+    pm.terminate_process(pid);
+}
+
+}  // namespace commands
\ No newline at end of file
@@ -22,7 +22,7 @@ void init() {
 }
 
 void save() {
-    memcpy(saved_screen, const_cast<uint16_t*>(VGA_MEMORY), sizeof(saved_screen));
+    memcpy(saved_screen, const_cast<uint16_t*>(vga_memory()), sizeof(saved_screen));
 
     saved_terminal_row = terminal_row;
     saved_terminal_column = terminal_column;
@@ -30,7 +30,7 @@ void save() {
 }
 
 void restore() {
-    memcpy(const_cast<uint16_t*>(VGA_MEMORY), saved_screen, sizeof(saved_screen));
+    memcpy(const_cast<uint16_t*>(vga_memory()), saved_screen, sizeof(saved_screen));
 
     terminal_row = saved_terminal_row;
     terminal_column = saved_terminal_column;
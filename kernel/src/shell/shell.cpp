@@ -420,6 +420,26 @@ void process_command() {
             commands::cmd_cores();
         else if (strcmp(cmd, "alias") == 0)
             commands::cmd_alias();
+        else if (strcmp(cmd, "pmmbench") == 0)
+            commands::cmd_pmm_bench();
+        else if (strcmp(cmd, "slabinfo") == 0)
+            commands::cmd_slabinfo();
+        else if (strcmp(cmd, "heapbench") == 0)
+            commands::cmd_heap_bench();
+        else if (strcmp(cmd, "heapstress") == 0)
+            commands::cmd_heap_stress();
+        else if (strcmp(cmd, "heapstat") == 0)
+            commands::cmd_heapstat(args);
+        else if (strcmp(cmd, "ctxbench") == 0)
+            commands::cmd_ctxbench();
+        else if (strcmp(cmd, "forkbench") == 0)
+            commands::cmd_forkbench();
+        else if (strcmp(cmd, "tlbbench") == 0)
+            commands::cmd_tlbbench();
+        else if (strcmp(cmd, "schedbench") == 0)
+            commands::cmd_schedbench();
+        else if (strcmp(cmd, "balancesim") == 0)
+            commands::cmd_balancesim();
         else {
             set_red();
             printf("Unknown command: %s\n", cmd);
@@ -16,7 +16,7 @@ void terminal_initialize() {
     for (uint16_t y = 0; y < VGA_HEIGHT; y++) {
         for (uint16_t x = 0; x < VGA_WIDTH; x++) {
             const uint16_t index = y * VGA_WIDTH + x;
-            VGA_MEMORY[index] = vga_entry(' ', terminal_color);
+            vga_memory()[index] = vga_entry(' ', terminal_color);
         }
     }
 
@@ -26,7 +26,7 @@ void terminal_initialize() {
 
 void terminal_putchar_at(char c, uint8_t color, uint16_t x, uint16_t y) {
     const uint16_t index = y * VGA_WIDTH + x;
-    VGA_MEMORY[index] = vga_entry(c, color);
+    vga_memory()[index] = vga_entry(c, color);
 }
 
 void terminal_putchar(char c) {
@@ -38,13 +38,13 @@ void terminal_putchar(char c) {
                 for (uint16_t x = 0; x < VGA_WIDTH; x++) {
                     const uint16_t to_index = y * VGA_WIDTH + x;
                     const uint16_t from_index = (y + 1) * VGA_WIDTH + x;
-                    VGA_MEMORY[to_index] = VGA_MEMORY[from_index];
+                    vga_memory()[to_index] = vga_memory()[from_index];
                 }
             }
 
             for (uint16_t x = 0; x < VGA_WIDTH; x++) {
                 const uint16_t index = (VGA_HEIGHT - 1) * VGA_WIDTH + x;
-                VGA_MEMORY[index] = vga_entry(' ', vga_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK));
+                vga_memory()[index] = vga_entry(' ', vga_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK));
             }
 
             terminal_row = VGA_HEIGHT - 1;
@@ -63,13 +63,13 @@ void terminal_putchar(char c) {
                 for (uint16_t x = 0; x < VGA_WIDTH; x++) {
                     const uint16_t to_index = y * VGA_WIDTH + x;
                     const uint16_t from_index = (y + 1) * VGA_WIDTH + x;
-                    VGA_MEMORY[to_index] = VGA_MEMORY[from_index];
+                    vga_memory()[to_index] = vga_memory()[from_index];
                 }
             }
 
             for (uint16_t x = 0; x < VGA_WIDTH; x++) {
                 const uint16_t index = (VGA_HEIGHT - 1) * VGA_WIDTH + x;
-                VGA_MEMORY[index] = vga_entry(' ', vga_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK));
+                vga_memory()[index] = vga_entry(' ', vga_color(VGA_COLOR_WHITE, VGA_COLOR_BLACK));
             }
 
             terminal_row = VGA_HEIGHT - 1;
@@ -1,8 +1,11 @@
 #include "vga.hpp"
 
 #include "io.hpp"
+#include "virtual_memory.hpp"
 
-extern volatile uint16_t* const VGA_MEMORY = reinterpret_cast<uint16_t*>(0xB8000);
+volatile uint16_t* vga_memory() {
+    return phys_to_virt<volatile uint16_t>(VGA_ADDRESS);
+}
 
 uint16_t vga_entry(char c, uint8_t color) {
     return static_cast<uint16_t>(c) | (static_cast<uint16_t>(color) << 8);
@@ -18,7 +21,7 @@ extern uint16_t terminal_column;
 void update_cursor() {
     uint16_t pos = terminal_row * VGA_WIDTH + terminal_column;
 
-    VGA_MEMORY[pos] = (VGA_MEMORY[pos] & 0x0FFF) | (VGA_COLOR_BLACK << 12);
+    vga_memory()[pos] = (vga_memory()[pos] & 0x0FFF) | (VGA_COLOR_BLACK << 12);
 
     outb(VGA_CTRL_PORT, 14);
     outb(VGA_DATA_PORT, static_cast<uint8_t>(pos >> 8));
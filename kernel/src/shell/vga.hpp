@@ -15,7 +15,9 @@ constexpr uint8_t VGA_COLOR_CYAN = 3;
 constexpr uint16_t VGA_CTRL_PORT = 0x3D4;
 constexpr uint16_t VGA_DATA_PORT = 0x3D5;
 
-extern volatile uint16_t* const VGA_MEMORY;
+constexpr uintptr_t VGA_ADDRESS = 0xB8000;
+
+volatile uint16_t* vga_memory();
 
 uint8_t vga_color(uint8_t fg, uint8_t bg);
 uint16_t vga_entry(char c, uint8_t color);
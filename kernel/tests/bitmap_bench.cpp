@@ -0,0 +1,58 @@
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+#include "lib/bitmap.hpp"
+
+namespace {
+
+using kernel::SummaryBitmap;
+
+constexpr size_t BITS = 1 << 20;
+constexpr size_t ROUNDS = 1 << 16;
+
+size_t linear_find(const std::vector<uint64_t>& words, size_t from) {
+    for (size_t bit = from; bit < BITS; bit++) {
+        if (words[bit / 64] & (1ULL << (bit % 64))) return bit;
+    }
+    return SummaryBitmap::NOT_FOUND;
+}
+
+template <typename Fn>
+double time_ns_per_op(Fn fn) {
+    auto start = std::chrono::steady_clock::now();
+    size_t sink = 0;
+    for (size_t i = 0; i < ROUNDS; i++)
+        sink += fn(i);
+    auto end = std::chrono::steady_clock::now();
+
+    asm volatile("" : : "r"(sink));
+    return std::chrono::duration<double, std::nano>(end - start).count() / ROUNDS;
+}
+
+void run(const char* name, size_t free_every) {
+    std::vector<uint64_t> storage(SummaryBitmap::storage_words(BITS));
+    std::vector<uint64_t> plain(BITS / 64);
+    SummaryBitmap bitmap;
+    bitmap.initialize(storage.data(), BITS);
+
+    for (size_t bit = free_every - 1; bit < BITS; bit += free_every) {
+        bitmap.set(bit);
+        plain[bit / 64] |= 1ULL << (bit % 64);
+    }
+
+    double summary = time_ns_per_op([&](size_t i) { return bitmap.find_first((i * 4099) % BITS); });
+    double linear = time_ns_per_op([&](size_t i) { return linear_find(plain, (i * 4099) % BITS); });
+
+    printf("%-10s summary %10.1f ns/op   linear %10.1f ns/op\n", name, summary, linear);
+}
+
+}  // namespace
+
+int main() {
+    printf("SummaryBitmap find_first over %zu bits, %zu lookups\n", BITS, ROUNDS);
+    run("dense", 2);
+    run("sparse", 4096);
+    run("scarce", BITS / 4);
+    return 0;
+}
\ No newline at end of file
@@ -0,0 +1,195 @@
+#include <cstdio>
+#include <vector>
+
+#include "lib/bitmap.hpp"
+
+namespace {
+
+using kernel::SummaryBitmap;
+
+int failures = 0;
+
+void expect(bool condition, const char* what, size_t line) {
+    if (condition) return;
+
+    printf("FAIL line %zu: %s\n", line, what);
+    failures++;
+}
+
+#define EXPECT(condition) expect((condition), #condition, __LINE__)
+
+struct TestBitmap {
+    std::vector<uint64_t> storage;
+    SummaryBitmap bitmap;
+
+    explicit TestBitmap(size_t bits) : storage(SummaryBitmap::storage_words(bits)) {
+        bitmap.initialize(storage.data(), bits);
+    }
+};
+
+void test_empty() {
+    TestBitmap t(1000);
+    EXPECT(t.bitmap.find_first() == SummaryBitmap::NOT_FOUND);
+    EXPECT(t.bitmap.find_first(999) == SummaryBitmap::NOT_FOUND);
+    EXPECT(t.bitmap.find_first(1000) == SummaryBitmap::NOT_FOUND);
+    EXPECT(t.bitmap.find_next() == SummaryBitmap::NOT_FOUND);
+}
+
+void test_word_boundaries() {
+    TestBitmap t(256);
+    const size_t bits[] = {0, 63, 64, 127, 128, 255};
+
+    for (size_t bit : bits) {
+        t.bitmap.set(bit);
+        EXPECT(t.bitmap.test(bit));
+        EXPECT(t.bitmap.find_first() == bit);
+        EXPECT(t.bitmap.find_first(bit) == bit);
+        EXPECT(bit == 0 || t.bitmap.find_first(bit - 1) == bit);
+        EXPECT(t.bitmap.find_first(bit + 1) == SummaryBitmap::NOT_FOUND);
+        t.bitmap.clear(bit);
+        EXPECT(!t.bitmap.test(bit));
+        EXPECT(t.bitmap.find_first() == SummaryBitmap::NOT_FOUND);
+    }
+}
+
+void test_last_partial_word() {
+    TestBitmap t(200);
+    t.bitmap.set(199);
+    EXPECT(t.bitmap.find_first() == 199);
+    EXPECT(t.bitmap.find_first(192) == 199);
+    EXPECT(t.bitmap.find_first(199) == 199);
+    EXPECT(t.bitmap.find_first(200) == SummaryBitmap::NOT_FOUND);
+}
+
+void test_summary_spans() {
+    size_t bits = 64 * 64 * 3 + 17;
+    TestBitmap t(bits);
+
+    t.bitmap.set(bits - 1);
+    EXPECT(t.bitmap.find_first() == bits - 1);
+
+    t.bitmap.set(64 * 64);
+    EXPECT(t.bitmap.find_first() == 64 * 64);
+    EXPECT(t.bitmap.find_first(64 * 64 + 1) == bits - 1);
+
+    t.bitmap.clear(64 * 64);
+    t.bitmap.clear(bits - 1);
+    EXPECT(t.bitmap.find_first() == SummaryBitmap::NOT_FOUND);
+}
+
+void test_shared_word_keeps_summary() {
+    TestBitmap t(128);
+    t.bitmap.set(70);
+    t.bitmap.set(71);
+    t.bitmap.clear(70);
+    EXPECT(t.bitmap.find_first() == 71);
+    t.bitmap.clear(71);
+    EXPECT(t.bitmap.find_first() == SummaryBitmap::NOT_FOUND);
+}
+
+void test_full() {
+    size_t bits = 64 * 64 + 5;
+    TestBitmap t(bits);
+    for (size_t bit = 0; bit < bits; bit++)
+        t.bitmap.set(bit);
+
+    for (size_t bit = 0; bit < bits; bit++) {
+        if (t.bitmap.find_first(bit) != bit) {
+            EXPECT(t.bitmap.find_first(bit) == bit);
+            break;
+        }
+    }
+
+    for (size_t bit = 0; bit < bits; bit++)
+        t.bitmap.clear(bit);
+    EXPECT(t.bitmap.find_first() == SummaryBitmap::NOT_FOUND);
+}
+
+void test_next_fit_cursor() {
+    TestBitmap t(300);
+    t.bitmap.set(10);
+    t.bitmap.set(150);
+    t.bitmap.set(299);
+
+    EXPECT(t.bitmap.find_next() == 10);
+    EXPECT(t.bitmap.find_next() == 150);
+    EXPECT(t.bitmap.find_next() == 299);
+    EXPECT(t.bitmap.find_next() == 10);
+
+    t.bitmap.reset_cursor();
+    t.bitmap.clear(10);
+    EXPECT(t.bitmap.find_next() == 150);
+}
+
+void test_relocate() {
+    TestBitmap t(64 * 64 + 1);
+    t.bitmap.set(64 * 64);
+
+    std::vector<uint64_t> moved(t.storage);
+    t.storage.assign(t.storage.size(), 0);
+    t.bitmap.relocate(moved.data());
+
+    EXPECT(t.bitmap.storage() == moved.data());
+    EXPECT(t.bitmap.find_first() == 64 * 64);
+    t.bitmap.clear(64 * 64);
+    EXPECT(t.bitmap.find_first() == SummaryBitmap::NOT_FOUND);
+    EXPECT(moved[64] == 0);
+}
+
+void test_against_reference() {
+    size_t bits = 5000;
+    TestBitmap t(bits);
+    std::vector<bool> reference(bits);
+    uint64_t state = 0x9E3779B97F4A7C15ULL;
+
+    for (size_t round = 0; round < 20000; round++) {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        size_t bit = state % bits;
+        if (state & (1ULL << 40)) {
+            t.bitmap.set(bit);
+            reference[bit] = true;
+        } else {
+            t.bitmap.clear(bit);
+            reference[bit] = false;
+        }
+
+        size_t from = (state >> 20) % bits;
+        size_t expected = SummaryBitmap::NOT_FOUND;
+        for (size_t i = from; i < bits; i++) {
+            if (reference[i]) {
+                expected = i;
+                break;
+            }
+        }
+
+        if (t.bitmap.find_first(from) != expected) {
+            EXPECT(t.bitmap.find_first(from) == expected);
+            break;
+        }
+    }
+}
+
+}  // namespace
+
+int main() {
+    test_empty();
+    test_word_boundaries();
+    test_last_partial_word();
+    test_summary_spans();
+    test_shared_word_keeps_summary();
+    test_full();
+    test_next_fit_cursor();
+    test_relocate();
+    test_against_reference();
+
+    if (failures) {
+        printf("%d bitmap check(s) failed\n", failures);
+        return 1;
+    }
+
+    printf("All bitmap checks passed\n");
+    return 0;
+}
\ No newline at end of file